@@ -0,0 +1,69 @@
+/**
+ * @file bench.h
+ * @brief Measurement helpers shared by the benchmarks.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace bench {
+
+/**
+ * @brief Returns the user plus system CPU time consumed so far by the process (`RUSAGE_SELF`) or the calling thread.
+ */
+inline std::chrono::nanoseconds CpuTime(int who = RUSAGE_SELF) {
+    using namespace std::chrono;
+    rusage usage {};
+    ::getrusage(who, &usage);
+    return seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+	+ microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/**
+ * @brief Returns the number of voluntary and involuntary context switches of the process so far.
+ */
+inline long ContextSwitches() {
+    rusage usage {};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+/**
+ * @brief Returns the `p`-th percentile, 0 to 100, of the samples in microseconds; reorders the samples.
+ */
+inline double Percentile(std::vector<std::chrono::nanoseconds>& samples, double p) {
+    if (samples.empty()) {
+	return 0;
+    }
+    auto index = std::min(samples.size() - 1, static_cast<size_t>(samples.size() * p / 100));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index].count() / 1e3;
+}
+
+/**
+ * @brief Prints the p50, p99 and maximum of the samples in microseconds after a label.
+ */
+inline void PrintLatency(const char* label, std::vector<std::chrono::nanoseconds>& samples) {
+    auto p50 = Percentile(samples, 50);
+    auto p99 = Percentile(samples, 99);
+    auto max = Percentile(samples, 100);
+    std::printf("  %-28s p50 %9.1f us  p99 %9.1f us  max %9.1f us\n", label, p50, p99, max);
+}
+
+/**
+ * @brief Runs `fn` once and returns how long it took, in milliseconds.
+ */
+template<typename F>
+double Millis(F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace bench
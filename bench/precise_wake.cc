@@ -0,0 +1,77 @@
+// End-to-end lateness and CPU of the event loop per wake mode, and how fast an already due task is picked up.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "scheduler/scheduler.h"
+
+using namespace scheduler;
+using namespace std::chrono;
+
+namespace {
+
+constexpr int kSeconds = 6;
+constexpr int kPerSecond = 20;
+
+void Measure(const char* name, WakeMode mode) {
+    Scheduler scheduler(256, 2);
+    if (!scheduler.SetWakeMode(mode)) {
+	std::printf("  %-10s unsupported\n", name);
+	return;
+    }
+    scheduler.Run();
+
+    std::mutex mutex;
+    std::vector<nanoseconds> lateness;
+    auto first = std::time(nullptr) + 1;
+    for (int second = 0; second < kSeconds; ++second) {
+	for (int i = 0; i < kPerSecond; ++i) {
+	    auto deadline = first + second;
+	    scheduler.Add([&, deadline]() {
+		auto late = system_clock::now() - system_clock::from_time_t(deadline);
+		std::lock_guard lock(mutex);
+		lateness.push_back(late);
+	    }, deadline);
+	}
+    }
+
+    auto cpu = bench::CpuTime();
+    std::this_thread::sleep_until(system_clock::from_time_t(first + kSeconds) + milliseconds(100));
+    auto used = duration<double>(bench::CpuTime() - cpu).count();
+
+    // Picked up from a sleeping loop: the time from `Add` to the task running.
+    std::vector<nanoseconds> pickup;
+    for (int i = 0; i < 50; ++i) {
+	std::this_thread::sleep_for(milliseconds(2));
+	std::atomic<bool> ran = false;
+	steady_clock::time_point ran_at;
+	auto added = steady_clock::now();
+	scheduler.Add([&]() { ran_at = steady_clock::now(); ran = true; }, std::time(nullptr));
+	while (!ran) {
+	    std::this_thread::yield();
+	}
+	pickup.push_back(ran_at - added);
+    }
+    scheduler.Shutdown();
+
+    auto p50 = bench::Percentile(lateness, 50);
+    auto p99 = bench::Percentile(lateness, 99);
+    std::printf("  %-10s lateness p50 %7.1f us  p99 %7.1f us  CPU %.2f s over %d s  due Add picked up in %.1f us\n",
+	name, p50, p99, used, kSeconds, bench::Percentile(pickup, 50));
+}
+
+} // namespace
+
+int main() {
+    std::printf("%d tasks due on each of %d consecutive seconds, 2 workers:\n", kPerSecond, kSeconds);
+    Measure("BusyPoll", WakeMode::BusyPoll);
+    Measure("Precise", WakeMode::Precise);
+    Measure("TimerFd", WakeMode::TimerFd);
+    return 0;
+}
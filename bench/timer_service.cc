@@ -0,0 +1,59 @@
+// CPU used by 100 schedulers over one shared pool: standalone event loops, busy-polling or sleeping, against one
+// shared TimerService.
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "scheduler/scheduler.h"
+
+using namespace scheduler;
+using namespace std::chrono;
+
+namespace {
+
+constexpr int kSchedulers = 100;
+constexpr auto kWindow = seconds(2);
+
+template<typename Make>
+void Measure(const char* label, Make&& make) {
+    auto pool = std::make_shared<internal::ThreadPool>(2, 1024);
+    pool->Run();
+
+    std::vector<std::unique_ptr<Scheduler>> schedulers;
+    for (int i = 0; i < kSchedulers; ++i) {
+	schedulers.push_back(make(pool));
+	schedulers.back()->Run();
+	schedulers.back()->Add([]() {}, std::time(nullptr) + 1);
+    }
+
+    auto cpu = bench::CpuTime();
+    std::this_thread::sleep_for(kWindow);
+    auto per_second = duration<double>(bench::CpuTime() - cpu).count() / duration<double>(kWindow).count();
+
+    for (auto& scheduler: schedulers) {
+	scheduler->Shutdown();
+    }
+    pool->Shutdown();
+    std::printf("  %-24s %.2f s CPU per second\n", label, per_second);
+}
+
+} // namespace
+
+int main() {
+    std::printf("%d schedulers sharing one pool:\n", kSchedulers);
+    Measure("standalone event loops", [](auto& pool) { return std::make_unique<Scheduler>(16, pool); });
+    Measure("standalone, precise wake", [](auto& pool) {
+	auto scheduler = std::make_unique<Scheduler>(16, pool);
+	scheduler->SetWakeMode(WakeMode::Precise);
+	return scheduler;
+    });
+    Measure("one TimerService", [](auto& pool) {
+	return std::make_unique<Scheduler>(16, pool, TimerService::Global());
+    });
+    return 0;
+}
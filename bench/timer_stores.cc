@@ -0,0 +1,180 @@
+// The pending-task stores: the expiry scan at 1M deadlines, a trace-like workload per backend, bytes per pending
+// timer, and a day of 2M timers popped second by second.
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <list>
+#include <malloc.h>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "scheduler/compact_heap.h"
+#include "scheduler/deadline_array.h"
+#include "scheduler/ladder_queue.h"
+#include "scheduler/radix_heap.h"
+
+using namespace scheduler::internal;
+
+namespace {
+
+/// Stands in for the scheduler's own task: a deadline next to a `std::function`.
+struct Task {
+    std::time_t timestamp = 0;
+    std::function<void()> func;
+};
+
+/// A comparison heap as the baseline, with the same interface as the stores.
+class PriorityQueue {
+public:
+    void Push(int64_t deadline, Task value) {
+	heap_.push(Entry { deadline, std::move(value) });
+    }
+
+    template<typename F>
+    void PopExpired(int64_t now, F&& fn) {
+	while (!heap_.empty() && heap_.top().key <= now) {
+	    fn(std::move(const_cast<Entry&>(heap_.top()).value));
+	    heap_.pop();
+	}
+    }
+
+private:
+    struct Entry {
+	int64_t key;
+	Task value;
+	bool operator<(const Entry& other) const noexcept { return key > other.key; }
+    };
+
+    std::priority_queue<Entry> heap_;
+};
+
+/// Bytes allocated from the heap, including the large blocks malloc maps separately.
+size_t HeapBytes() {
+    auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+void ScanAt1M() {
+    constexpr size_t kEntries = 1'000'000;
+    std::vector<int64_t> deadlines(kEntries);
+    std::mt19937_64 random(1);
+    for (auto& deadline: deadlines) {
+	deadline = static_cast<int64_t>(random() % 1000);
+    }
+    std::vector<uint32_t> out(kEntries + scan::kScanSlack);
+
+    auto run = [&](const char* name, scan::Kernel kernel) {
+	double best = 1e9;
+	for (int i = 0; i < 20; ++i) {
+	    best = std::min(best, bench::Millis([&]() { kernel(deadlines.data(), kEntries, 10, out.data()); }));
+	}
+	std::printf("  %-8s %7.0f us\n", name, best * 1e3);
+    };
+
+    std::printf("Expiry scan of 1M deadlines, 1%% expired, best of 20:\n");
+    run("scalar", scan::ScanScalar);
+#ifdef SCHEDULER_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	run("AVX2", scan::ScanAvx2);
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+	run("AVX-512", scan::ScanAvx512);
+    }
+#endif
+}
+
+// 500 inserts per simulated second, 90% due within a minute and 10% within 30 days, popped every second.
+template<typename Store>
+void Trace(const char* name) {
+    constexpr int64_t kSeconds = 2000;
+    constexpr int kPerSecond = 500;
+    Store store;
+    std::mt19937_64 random(2);
+    size_t popped = 0;
+
+    auto millis = bench::Millis([&]() {
+	for (int64_t now = 0; now < kSeconds; ++now) {
+	    for (int i = 0; i < kPerSecond; ++i) {
+		auto delay = random() % 10 ? 1 + random() % 60 : 1 + random() % (30 * 24 * 3600);
+		auto deadline = now + static_cast<int64_t>(delay);
+		store.Push(deadline, Task { .timestamp = deadline, .func = []() {} });
+	    }
+	    store.PopExpired(now, [&](Task&&) { ++popped; });
+	}
+    });
+    std::printf("  %-16s %6.0f ms  (%zu popped)\n", name, millis, popped);
+}
+
+template<typename Store>
+void BytesPerTimer(const char* name) {
+    constexpr size_t kTimers = 1'000'000;
+    auto before = HeapBytes();
+    {
+	Store store;
+	for (size_t i = 0; i < kTimers; ++i) {
+	    store.Push(static_cast<int64_t>(i % 86400), Task { .timestamp = 0, .func = []() {} });
+	}
+	std::printf("  %-16s %5.1f B\n", name, static_cast<double>(HeapBytes() - before) / kTimers);
+    }
+}
+
+/// The store the scheduler started out with: a list of tasks.
+struct TaskList {
+    void Push(int64_t deadline, Task value) {
+	value.timestamp = deadline;
+	tasks.push_back(std::move(value));
+    }
+
+    std::list<Task> tasks;
+};
+
+// 2M timers spread over a day, popped second by second.
+template<typename Store>
+void Day(const char* name) {
+    constexpr size_t kTimers = 2'000'000;
+    constexpr int64_t kDay = 86400;
+    Store store;
+    std::mt19937_64 random(3);
+
+    auto push = bench::Millis([&]() {
+	for (size_t i = 0; i < kTimers; ++i) {
+	    store.Push(static_cast<int64_t>(random() % kDay), Task {});
+	}
+    });
+    auto pop = bench::Millis([&]() {
+	for (int64_t now = 0; now < kDay; ++now) {
+	    store.PopExpired(now, [](Task&&) {});
+	}
+    });
+    std::printf("  %-16s push %5.0f ms  pop %5.0f ms\n", name, push, pop);
+}
+
+} // namespace
+
+int main() {
+    ScanAt1M();
+
+    std::printf("Trace-like workload, 2000 s simulated:\n");
+    Trace<DeadlineArray<Task>>("DeadlineArray");
+    Trace<RadixHeap<Task>>("RadixHeap");
+    Trace<LadderQueue<Task>>("LadderQueue");
+    Trace<CompactHeap<Task>>("CompactHeap");
+    Trace<PriorityQueue>("priority_queue");
+
+    std::printf("Heap bytes per pending timer, 1M timers, sizeof(Task) = %zu:\n", sizeof(Task));
+    BytesPerTimer<TaskList>("std::list<Task>");
+    BytesPerTimer<DeadlineArray<Task>>("DeadlineArray");
+    BytesPerTimer<RadixHeap<Task>>("RadixHeap");
+    BytesPerTimer<LadderQueue<Task>>("LadderQueue");
+    BytesPerTimer<CompactHeap<Task>>("CompactHeap");
+
+    std::printf("2M timers over a day, popped second by second:\n");
+    Day<PriorityQueue>("priority_queue");
+    Day<CompactHeap<Task>>("CompactHeap");
+    return 0;
+}
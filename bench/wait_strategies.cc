@@ -0,0 +1,82 @@
+// Latency against CPU for every wait strategy of the circular buffer, and the lateness of timed waits.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "scheduler/circular_buffer.h"
+#include "scheduler/wait_strategy.h"
+
+using namespace scheduler::internal;
+using namespace std::chrono;
+
+namespace {
+
+constexpr int kMessages = 2000;
+constexpr auto kSpacing = microseconds(200);
+
+// A consumer blocks in Pop while the producer pushes a timestamp every `kSpacing`.
+template<typename Wait>
+void PushToPop(const char* name) {
+    SPMCCircularBuffer<steady_clock::time_point, Wait> buffer(64);
+    std::vector<nanoseconds> latencies;
+    latencies.reserve(kMessages);
+    nanoseconds cpu {};
+
+    std::thread consumer([&]() {
+	auto start = bench::CpuTime(RUSAGE_THREAD);
+	for (int i = 0; i < kMessages; ++i) {
+	    auto pushed = buffer.Pop();
+	    latencies.push_back(steady_clock::now() - pushed);
+	}
+	cpu = bench::CpuTime(RUSAGE_THREAD) - start;
+    });
+
+    auto wall = steady_clock::now();
+    for (int i = 0; i < kMessages; ++i) {
+	std::this_thread::sleep_for(kSpacing);
+	buffer.EmplacePush(steady_clock::now());
+    }
+    consumer.join();
+
+    auto elapsed = duration<double>(steady_clock::now() - wall).count();
+    auto p50 = bench::Percentile(latencies, 50);
+    auto p99 = bench::Percentile(latencies, 99);
+    std::printf("  %-12s p50 %8.1f us  p99 %8.1f us  consumer CPU %5.1f%%\n", name, p50, p99,
+	100 * duration<double>(cpu).count() / elapsed);
+}
+
+// How late a timed wait on an atomic that never changes returns after its deadline.
+template<typename Wait>
+void TimedWaitLateness(const char* name) {
+    constexpr int kSamples = 400;
+    Wait wait;
+    std::atomic<uint32_t> never = 0;
+    std::vector<nanoseconds> lateness;
+
+    for (int i = 0; i < kSamples; ++i) {
+	auto deadline = steady_clock::now() + milliseconds(5);
+	wait.WaitUntil(never, 0u, deadline);
+	lateness.push_back(steady_clock::now() - deadline);
+    }
+    bench::PrintLatency(name, lateness);
+}
+
+} // namespace
+
+int main() {
+    std::printf("Push to Pop latency, one message every %lld us:\n", static_cast<long long>(kSpacing.count()));
+    PushToPop<SpinWait>("SpinWait");
+    PushToPop<YieldWait>("YieldWait");
+    PushToPop<BackoffWait>("BackoffWait");
+    PushToPop<FutexWait>("FutexWait");
+    PushToPop<HybridWait>("HybridWait");
+
+    std::printf("Lateness of a 5 ms timed wait:\n");
+    TimedWaitLateness<FutexWait>("FutexWait");
+    TimedWaitLateness<HybridWait>("HybridWait");
+    return 0;
+}
@@ -0,0 +1,48 @@
+// Context switches per task when an idle pool is fed one task at a time: every task should wake one worker only.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "bench.h"
+#include "scheduler/threadpool.h"
+
+using namespace scheduler::internal;
+using namespace std::chrono;
+
+namespace {
+
+constexpr int kTasks = 2000;
+
+void SpacedTasks(size_t workers) {
+    ThreadPool pool(workers, 1024);
+    pool.Run();
+    std::this_thread::sleep_for(milliseconds(50));
+
+    std::atomic<int> done = 0;
+    auto switches = bench::ContextSwitches();
+    for (int i = 0; i < kTasks; ++i) {
+	pool.AddTask([&done]() { ++done; });
+	// Long enough for the worker to finish and park again, so every task finds the pool idle.
+	std::this_thread::sleep_for(microseconds(200));
+    }
+    while (done < kTasks) {
+	std::this_thread::yield();
+    }
+    auto per_task = static_cast<double>(bench::ContextSwitches() - switches) / kTasks;
+    pool.Shutdown();
+
+    // The producer's own sleep accounts for one switch per task.
+    std::printf("  %2zu workers: %.2f context switches per task\n", workers, per_task);
+}
+
+} // namespace
+
+int main() {
+    std::printf("%d tasks, 200 us apart:\n", kTasks);
+    for (size_t workers: { 1, 8, 32 }) {
+	SpacedTasks(workers);
+    }
+    return 0;
+}
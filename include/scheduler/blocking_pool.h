@@ -0,0 +1,200 @@
+/**
+ * @file blocking_pool.h
+ * @brief Header file for the BlockingPool class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "executor.h"
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief An elastic thread pool for tasks that block, e.g. on file I/O.
+ *
+ * Unlike `ThreadPool`, which keeps a fixed set of workers busy with short, latency-critical callbacks,
+ * this pool starts with no threads at all. A thread is spawned whenever a task arrives and no thread is idle,
+ * up to `max_threads`; a thread that stays idle for `keep_alive` retires. A long blocking call therefore
+ * occupies a thread of its own instead of delaying every other expired timer.
+ *
+ * Throughput is not a concern here, so the queue is a plain mutex-protected deque.
+ *
+ * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
+ */
+class BlockingPool : public Executor {
+public:
+    using Fn = std::function<void()>;
+
+    /**
+     * @brief Constructs a BlockingPool.
+     *
+     * @param max_threads The maximum number of threads the pool may grow to.
+     * @param keep_alive How long an idle thread waits for new work before it retires.
+     */
+    BlockingPool(size_t max_threads, std::chrono::milliseconds keep_alive = std::chrono::seconds(10))
+	: max_threads_{std::max<size_t>(max_threads, 1)},
+	  keep_alive_{keep_alive}
+    {}
+
+    /**
+     * @brief Destructor for the BlockingPool class. Executes the remaining tasks and joins every thread.
+     */
+    ~BlockingPool() override {
+	Shutdown();
+    }
+
+    BlockingPool(const BlockingPool&) = delete;
+    BlockingPool(const BlockingPool&&) = delete;
+    BlockingPool& operator=(const BlockingPool&)= delete;
+    BlockingPool& operator=(BlockingPool&&) = delete;
+
+    /**
+     * @brief Adds a new task to the pool, spawning a thread for it if none is idle.
+     *
+     * @param task The task to be executed.
+     */
+    void AddTask(Fn task) {
+	std::unique_lock lock(mutex_);
+	JoinRetired();
+
+	queue_.push_back(std::move(task));
+	++submitted_;
+
+	if (idle_ < queue_.size() && threads_.size() < max_threads_) {
+	    auto it = threads_.emplace(threads_.end());
+	    *it = std::thread(&BlockingPool::Worker, this, it);
+	    peak_threads_ = std::max(peak_threads_, threads_.size());
+	} else {
+	    lock.unlock();
+	    cv_.notify_one();
+	}
+    }
+
+    /**
+     * @brief Same as `AddTask`; the pool is safe to use from any thread.
+     */
+    void Execute(Fn task) override {
+	AddTask(std::move(task));
+    }
+
+    /**
+     * @brief Allows the pool to accept and execute tasks again after a `Shutdown`.
+     *
+     * Threads are spawned lazily by `AddTask`, so there is nothing to launch here.
+     */
+    void Run() {
+	std::lock_guard lock(mutex_);
+	break_ = false;
+    }
+
+    /**
+     * @brief Waits for every queued task to be executed and joins all threads.
+     */
+    void Shutdown() {
+	std::list<std::thread> threads;
+	{
+	    std::lock_guard lock(mutex_);
+	    break_ = true;
+	    JoinRetired();
+	    threads.splice(threads.end(), threads_);
+	}
+	cv_.notify_all();
+
+	for (auto& thread: threads) {
+	    thread.join();
+	}
+    }
+
+    /**
+     * @brief Returns a snapshot of the pool's counters.
+     */
+    PoolMetrics Metrics() const override {
+	std::lock_guard lock(mutex_);
+	return PoolMetrics {
+	    .submitted = submitted_,
+	    .completed = completed_,
+	    .queued = queue_.size(),
+	    .threads = threads_.size() - retired_.size(),
+	    .peak_threads = peak_threads_,
+	};
+    }
+
+private:
+    using ThreadIt = std::list<std::thread>::iterator;
+
+    /**
+     * @brief The function executed by each thread: runs queued tasks and retires after `keep_alive_` of idleness.
+     *
+     * @param self The thread's own entry in `threads_`, handed to `retired_` when the thread exits on its own.
+     */
+    void Worker(ThreadIt self) {
+	std::unique_lock lock(mutex_);
+
+	for (;;) {
+	    if (!queue_.empty()) {
+		auto task = std::move(queue_.front());
+		queue_.pop_front();
+
+		lock.unlock();
+		std::invoke(task);
+		lock.lock();
+
+		++completed_;
+		continue;
+	    }
+
+	    if (break_) {
+		return;
+	    }
+
+	    ++idle_;
+	    bool woken = cv_.wait_for(lock, keep_alive_, [this] { return break_ || !queue_.empty(); });
+	    --idle_;
+
+	    if (!woken) {
+		retired_.push_back(self);
+		return;
+	    }
+	}
+    }
+
+    /**
+     * @brief Joins and forgets threads that retired on their own. Must be called under `mutex_`.
+     */
+    void JoinRetired() {
+	for (auto it: retired_) {
+	    it->join();
+	    threads_.erase(it);
+	}
+	retired_.clear();
+    }
+
+    size_t max_threads_;
+    std::chrono::milliseconds keep_alive_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Fn> queue_;
+    std::list<std::thread> threads_;
+    std::vector<ThreadIt> retired_;
+    size_t idle_ = 0;
+    size_t submitted_ = 0;
+    size_t completed_ = 0;
+    size_t peak_threads_ = 0;
+    bool break_ = false;
+};
+
+} // namespace internal
+} // namespace scheduler
@@ -15,6 +15,8 @@
 #include <optional>
 #include <utility>
 
+#include "wait_strategy.h"
+
 namespace scheduler {
 namespace internal {
 
@@ -26,6 +28,8 @@ namespace internal {
  * 
  * - **Thread Safety**: The buffer is thread-safe for multiple consumer threads, except for the `PopUnsafe` method, which should only be used in a single consumer scenario.
  * - **Lock-Free Writes**: Writes to the buffer are lock-free under normal conditions, ensuring high performance and low latency. Locks are only employed in the rare case of buffer overflow to maintain data integrity.
+ * - **Pluggable Blocking**: Every wait (full buffer, empty buffer, contended read lock) goes through the `Wait` strategy, trading CPU for wake-up latency.
+ * - **Zero-Copy Access**: `Claim`/`Commit` let the producer fill a slot in place, and `Peek`/`Release` let a single consumer inspect or consume it in place.
  * - **Use Cases**: 
  *   - **SPMC (Single Producer Multiple Consumer)**: Multiple consumer threads can safely read from the buffer concurrently, except when using `PopUnsafe`.
  *   - **SPSC (Single Producer Single Consumer)**: In this scenario, the `PopUnsafe` method can be used for even higher performance, as it avoids the overhead of synchronization mechanisms.
@@ -34,9 +38,10 @@ namespace internal {
 
  * 
  * @tparam T The type of elements stored in the buffer. This allows the buffer to be used with any data type.
+ * @tparam Wait The wait strategy (`SpinWait`, `YieldWait`, `BackoffWait` or `FutexWait`) used whenever a thread has to block.
  * @param size The amount of preallocated memory for the buffer, determining its capacity. This should be chosen based on the expected workload to minimize overflow conditions.
  */
-template<typename T>
+template<typename T, typename Wait = FutexWait>
 class SPMCCircularBuffer {
 public:
     /**
@@ -79,15 +84,73 @@ public:
      */
     template<typename... Args>
     void EmplacePush(Args&&... args) {
-	if (write_counter_ != 0 && (write_counter_ - read_counter_ == max_size_)) {
-	    int old_read = read_counter_;
-	    if (write_counter_ % max_size_ == old_read % max_size_)
-	    read_counter_.wait(old_read);
+	Claim() = T(std::forward<Args&&>(args)...);
+	Commit();
+    }
+
+    /**
+     * @brief Reserves the next free slot for the producer to fill in place.
+     * 
+     * @return A reference to the slot at the current write position.
+     * 
+     * @details
+     * First half of the two-phase producer API. If the buffer is full, the method waits until a consumer releases a slot.
+     * The slot still holds whatever element was previously moved out of it, so the caller is expected to assign every field it relies on.
+     * The element becomes visible to consumers only after a matching call to `Commit`.
+     * 
+     * @warning Only the single producer thread may call this method, and every `Claim` must be followed by exactly one `Commit`.
+     */
+    T& Claim() noexcept {
+	auto old_read = read_counter_.load();
+	while (write_counter_ - old_read == max_size_) {
+	    read_wait_.Wait(read_counter_, old_read);
+	    old_read = read_counter_.load();
 	}
 
-	buf_[write_counter_ % max_size_] = T(std::forward<Args&&>(args)...);
+	return buf_[write_counter_ % max_size_];
+    }
+
+    /**
+     * @brief Publishes the slot previously obtained from `Claim`.
+     * 
+     * @details
+     * Second half of the two-phase producer API. Advances the write position and wakes up a consumer waiting for data.
+     * Consumers wait for data only while holding the read lock, so there is never more than one such waiter and
+     * waking exactly one of them is enough; the rest are queued on the read lock, which is also released wake-one.
+     */
+    void Commit() noexcept {
 	write_counter_.fetch_add(1);
-	write_counter_.notify_all();
+	write_wait_.NotifyOne(write_counter_);
+    }
+
+    /**
+     * @brief Returns a reference to the oldest element without removing it from the buffer.
+     * 
+     * @return A reference to the slot at the current read position.
+     * 
+     * @details
+     * First half of the two-phase consumer API. The element can be inspected, modified or moved from in place;
+     * the slot is not handed back to the producer until `Release` is called. Aborts if the buffer is empty.
+     * 
+     * @warning Like `PopUnsafe`, this method should only be used in a single consumer scenario.
+     */
+    T& Peek() noexcept {
+	if (read_counter_ >= write_counter_) {
+	    std::abort();
+	}
+
+	return buf_[read_counter_ % max_size_];
+    }
+
+    /**
+     * @brief Hands the slot obtained from `Peek` back to the producer.
+     * 
+     * @details
+     * Second half of the two-phase consumer API. Advances the read position and wakes up the producer if it is waiting for space.
+     */
+    void Release() noexcept {
+	read_counter_.fetch_add(1);
+	read_wait_.NotifyOne(read_counter_);
     }
 
     /**
@@ -107,8 +170,7 @@ public:
 	}
 
 	T element = std::move_if_noexcept(buf_[read_counter_ % max_size_]);
-	read_counter_.fetch_add(1);
-	read_counter_.notify_all();
+	Release();
 	return element;
     }
 
@@ -119,23 +181,29 @@ public:
      * @return An optional containing the element if successful, or std::nullopt if the time limit is exceeded.
      * 
      * @details
-     * This method tries to acquire a lock and remove an element from the buffer. 
-     * If the buffer is empty and the lock cannot be acquired within the specified time, it returns std::nullopt.
+     * Both acquiring the read lock and waiting for an element to arrive count against the same deadline.
+     * While the buffer is empty the caller sleeps according to the `Wait` strategy and is woken by the
+     * next `Commit`, so idle consumers do not poll. Returns std::nullopt if no element arrived in time.
      */
     std::optional<T> TryPopFor(std::chrono::milliseconds limit_ms) noexcept { 
+	auto deadline = std::chrono::steady_clock::now() + limit_ms;
 	std::unique_lock lock(mutex_read_, std::defer_lock);
 
-	if (!lock.try_lock_for(std::chrono::duration(limit_ms))) {
+	if (!lock.try_lock_until(deadline)) {
 	    return std::nullopt;
 	} 
 
-	if (read_counter_ >= write_counter_) {
-	    return std::nullopt;
+	auto old_write = write_counter_.load();
+	while (read_counter_ >= old_write) {
+	    if (!write_wait_.WaitUntil(write_counter_, old_write, deadline)) {
+		return std::nullopt;
+	    }
+	    old_write = write_counter_.load();
 	}
 
-	T element = std::move_if_noexcept(buf_[read_counter_.fetch_add(1) % max_size_]);
-	read_counter_.notify_all();
-	return { element };
+	T element = std::move_if_noexcept(buf_[read_counter_ % max_size_]);
+	Release();
+	return { std::move(element) };
     }
 
     /**
@@ -152,12 +220,12 @@ public:
 	if (read_counter_ >= write_counter_) {
 	    auto old_write = write_counter_.load();
 	    if (read_counter_ >= old_write) {
-		write_counter_.wait(old_write);
+		write_wait_.Wait(write_counter_, old_write);
 	    }
 	}
 
-	T element = std::move_if_noexcept(buf_[read_counter_.fetch_add(1) % max_size_]);
-	read_counter_.notify_all();
+	T element = std::move_if_noexcept(buf_[read_counter_ % max_size_]);
+	Release();
 	return element;
     }
 
@@ -175,12 +243,26 @@ public:
 	return read_counter_ == write_counter_;
     }
 
+    /**
+     * @brief Checks if the buffer is full, i.e. whether `Claim` would have to wait.
+     * 
+     * @return True if the buffer is full, false otherwise.
+     * 
+     * @details
+     * Only meaningful when called by the producer; lets it divert elements elsewhere instead of blocking.
+     */
+    bool Full() const noexcept {
+	return write_counter_ - read_counter_ == max_size_;
+    }
+
 private:
     std::atomic<size_t> read_counter_ = 0;
     std::atomic<size_t> write_counter_ = 0;
     std::unique_ptr<T[]> buf_;
     size_t max_size_;
-    std::timed_mutex mutex_read_;
+    WaitLock<Wait> mutex_read_;
+    [[no_unique_address]] Wait read_wait_;
+    [[no_unique_address]] Wait write_wait_;
 };
 
 } // namespace internal
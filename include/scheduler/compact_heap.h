@@ -0,0 +1,312 @@
+/**
+ * @file compact_heap.h
+ * @brief Header file for the CompactHeap class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Priority queue of deadlines whose ordering structure holds 16-byte entries only.
+ *
+ * @details
+ * Values live in a slab with a free list and never move while pending. The heap itself orders compact entries:
+ * a 32-bit tick relative to a rolling epoch, a 32-bit slab index and a 64-bit sequence number that keeps entries
+ * with equal deadlines in insertion order.
+ *
+ * The heap is 4-ary and laid out so that the four children of a node fill exactly one 64-byte cache line:
+ * sifting down touches one line per level, and a level holds four times as many entries as in a binary heap.
+ *
+ * The epoch is placed `kEpochLead` ticks before the first deadline and rolls forward once "now" passes the middle
+ * of the 32-bit range, after everything due has been popped. Deadlines too far ahead to fit in 32 bits wait in an
+ * overflow list until the epoch catches up; a deadline behind the epoch moves the epoch back instead. No tick is
+ * ever clamped, so ordering by (tick, sequence) is always ordering by (deadline, insertion).
+ *
+ * @tparam T The value stored with every deadline.
+ */
+template<typename T>
+class CompactHeap {
+    /**
+     * @struct Entry
+     * @brief A heap entry: where the value is and when it is due.
+     */
+    struct Entry {
+	uint32_t tick;
+	uint32_t slot;
+	uint64_t sequence;
+    };
+
+    static_assert(sizeof(Entry) == 16);
+
+    /**
+     * @struct Line
+     * @brief A cache line of entries. Entry `i` of the heap is stored at flat position `i + 3`, so the children
+     * `4i + 1` to `4i + 4` of entry `i` are exactly line `i + 1`.
+     */
+    struct alignas(64) Line {
+	Entry entries[4];
+    };
+
+public:
+    /**
+     * @brief Adds a value with its deadline.
+     */
+    void Push(int64_t deadline, T value) {
+	if (!size_ && overflow_.empty()) {
+	    epoch_ = deadline - kEpochLead;
+	} else if (deadline < epoch_) {
+	    Rebase(deadline - kEpochLead);
+	}
+
+	auto slot = Allocate(std::move(value));
+	if (deadline - epoch_ > static_cast<int64_t>(kMaxTick)) {
+	    overflow_.push_back(Overflow { .deadline = deadline, .slot = slot });
+	    return;
+	}
+	Insert(Entry { .tick = Tick(deadline), .slot = slot, .sequence = sequence_++ });
+    }
+
+    /**
+     * @brief Removes every value whose deadline is not later than `now` and passes it to `fn`.
+     *
+     * @param now The current time, in the same unit as the deadlines.
+     * @param fn Called with an rvalue reference to every expired value, in deadline order.
+     */
+    template<typename F>
+    void PopExpired(int64_t now, F&& fn) {
+	PopHeap(now, fn);
+
+	// Whatever is left lies after "now", and therefore after the new epoch; overflowing values may come back due.
+	while (now - epoch_ > static_cast<int64_t>(kMaxTick / 2) && !Empty()) {
+	    Rebase(now - kEpochLead);
+	    PopHeap(now, fn);
+	}
+    }
+
+    /**
+     * @brief Removes up to `max` values regardless of their deadlines and passes each to `fn` with its deadline.
+     */
+    template<typename F>
+    void Extract(size_t max, F&& fn) {
+	for (; max && !overflow_.empty(); --max) {
+	    auto [deadline, slot] = overflow_.back();
+	    overflow_.pop_back();
+	    fn(deadline, std::move(slab_[slot]));
+	    Free(slot);
+	}
+
+	// Taking entries from the end keeps the heap property without any sifting.
+	for (; max && size_; --max) {
+	    auto entry = At(--size_);
+	    fn(epoch_ + entry.tick, std::move(slab_[entry.slot]));
+	    Free(entry.slot);
+	}
+    }
+
+    /**
+     * @brief Returns the earliest stored deadline, or the maximum representable one if there is none.
+     */
+    int64_t NextDeadline() const noexcept {
+	if (size_) {
+	    return epoch_ + At(0).tick;
+	}
+
+	// Overflowing deadlines are later than anything in the heap, so they only matter while the heap is empty.
+	auto next = std::numeric_limits<int64_t>::max();
+	for (auto& overflow: overflow_) {
+	    next = std::min(next, overflow.deadline);
+	}
+	return next;
+    }
+
+    /**
+     * @brief Returns the number of stored values.
+     */
+    size_t Size() const noexcept {
+	return size_ + overflow_.size();
+    }
+
+    /**
+     * @brief Checks whether no value is stored.
+     */
+    bool Empty() const noexcept {
+	return Size() == 0;
+    }
+
+    static constexpr uint32_t kMaxTick = std::numeric_limits<uint32_t>::max();
+    static constexpr int64_t kEpochLead = int64_t{1} << 30;
+
+private:
+    struct Overflow {
+	int64_t deadline;
+	uint32_t slot;
+    };
+
+    Entry& At(size_t index) noexcept {
+	auto position = index + 3;
+	return lines_[position / 4].entries[position % 4];
+    }
+
+    const Entry& At(size_t index) const noexcept {
+	auto position = index + 3;
+	return lines_[position / 4].entries[position % 4];
+    }
+
+    /**
+     * @brief Returns the tick of a deadline that lies between the epoch and `kMaxTick` ticks after it.
+     */
+    uint32_t Tick(int64_t deadline) const noexcept {
+	return static_cast<uint32_t>(deadline - epoch_);
+    }
+
+    static bool Before(const Entry& lhs, const Entry& rhs) noexcept {
+	return lhs.tick < rhs.tick || (lhs.tick == rhs.tick && lhs.sequence < rhs.sequence);
+    }
+
+    uint32_t Allocate(T value) {
+	if (free_.empty()) {
+	    slab_.push_back(std::move(value));
+	    return static_cast<uint32_t>(slab_.size() - 1);
+	}
+
+	auto slot = free_.back();
+	free_.pop_back();
+	slab_[slot] = std::move(value);
+	return slot;
+    }
+
+    void Free(uint32_t slot) {
+	slab_[slot] = T{};
+	free_.push_back(slot);
+    }
+
+    void Insert(Entry entry) {
+	if ((size_ + 3) / 4 >= lines_.size()) {
+	    lines_.resize(lines_.size() * 2 + 1);
+	}
+
+	auto index = size_++;
+	while (index) {
+	    auto parent = (index - 1) / 4;
+	    if (!Before(entry, At(parent))) {
+		break;
+	    }
+	    At(index) = At(parent);
+	    index = parent;
+	}
+	At(index) = entry;
+    }
+
+    void RemoveTop() noexcept {
+	auto last = At(--size_);
+	if (size_) {
+	    SiftDown(0, last);
+	}
+    }
+
+    /**
+     * @brief Places `entry` at `index` or below, moving the smaller children up. The slot at `index` is overwritten.
+     */
+    void SiftDown(size_t index, Entry entry) noexcept {
+	for (;;) {
+	    auto first = index * 4 + 1;
+	    if (first >= size_) {
+		break;
+	    }
+
+	    auto best = first;
+	    for (auto child = first + 1; child < std::min(first + 4, size_); ++child) {
+		if (Before(At(child), At(best))) {
+		    best = child;
+		}
+	    }
+	    if (!Before(At(best), entry)) {
+		break;
+	    }
+	    At(index) = At(best);
+	    index = best;
+	}
+	At(index) = entry;
+    }
+
+    /**
+     * @brief Pops the heap's values due by `now`. Overflowing values are later than any in the heap, so they wait.
+     */
+    template<typename F>
+    void PopHeap(int64_t now, F& fn) {
+	if (now < epoch_) {
+	    return;
+	}
+
+	// Every tick is at most `kMaxTick`, so a "now" beyond that range expires the whole heap.
+	auto limit = now - epoch_ >= static_cast<int64_t>(kMaxTick) ? kMaxTick : Tick(now);
+	while (size_ && At(0).tick <= limit) {
+	    auto slot = At(0).slot;
+	    RemoveTop();
+	    fn(std::move(slab_[slot]));
+	    Free(slot);
+	}
+    }
+
+    /**
+     * @brief Moves the epoch to `epoch`, or further back to the earliest stored deadline, so that no tick goes negative.
+     *
+     * Shifting every tick by the same amount keeps the heap order intact. Only if the epoch moves back can entries
+     * no longer fit in 32 bits; they are the latest ones and join the overflow list, and the heap is rebuilt.
+     * Overflowing deadlines that fit from now on are inserted in deadline order, so that ties keep their order.
+     */
+    void Rebase(int64_t epoch) {
+	epoch = std::min(epoch, NextDeadline());
+	auto delta = epoch - epoch_;
+
+	size_t kept = 0;
+	for (size_t i = 0; i < size_; ++i) {
+	    auto entry = At(i);
+	    auto tick = static_cast<int64_t>(entry.tick) - delta;
+	    if (tick > static_cast<int64_t>(kMaxTick)) {
+		overflow_.push_back(Overflow { .deadline = epoch_ + entry.tick, .slot = entry.slot });
+		continue;
+	    }
+	    entry.tick = static_cast<uint32_t>(tick);
+	    At(kept++) = entry;
+	}
+	if (kept != size_) {
+	    size_ = kept;
+	    for (auto i = size_ / 4 + 1; i-- > 0;) {
+		SiftDown(i, At(i));
+	    }
+	}
+	epoch_ = epoch;
+
+	auto fits = std::stable_partition(overflow_.begin(), overflow_.end(), [this](const Overflow& overflow) {
+	    return overflow.deadline - epoch_ > static_cast<int64_t>(kMaxTick);
+	});
+	std::stable_sort(fits, overflow_.end(), [](const Overflow& lhs, const Overflow& rhs) {
+	    return lhs.deadline < rhs.deadline;
+	});
+	for (auto it = fits; it != overflow_.end(); ++it) {
+	    Insert(Entry { .tick = Tick(it->deadline), .slot = it->slot, .sequence = sequence_++ });
+	}
+	overflow_.erase(fits, overflow_.end());
+    }
+
+    std::vector<Line> lines_;
+    size_t size_ = 0;
+    std::vector<T> slab_;
+    std::vector<uint32_t> free_;
+    std::vector<Overflow> overflow_;
+    int64_t epoch_ = 0;
+    uint64_t sequence_ = 0;
+};
+
+} // namespace internal
+} // namespace scheduler
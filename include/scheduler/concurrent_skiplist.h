@@ -0,0 +1,218 @@
+/**
+ * @file concurrent_skiplist.h
+ * @brief Header file for the ConcurrentSkipList class.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include "epoch_reclaimer.h"
+#include "wait_strategy.h"
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Lock-free, deadline-ordered skiplist with any number of inserting threads and a single popping thread.
+ *
+ * @details
+ * Producers link new entries directly into the ordered structure, so an entry is visible to the consumer as soon as
+ * `Insert` returns; there is no ingest queue to drain first. The consumer pops entries from the front only:
+ *
+ * - **Insertion**: a node is linked bottom-up with one compare-and-swap per level, level 0 being the linearization
+ *   point. It becomes poppable only once it is linked at every level, so a node is never unlinked by the consumer
+ *   while its producer is still linking it.
+ * - **Removal**: the consumer first marks every forward pointer of the front node, which makes producers' attempts
+ *   to link after it fail and retry, then unlinks it level by level.
+ * - **Reclamation**: producers traverse nodes under an `EpochReclaimer` guard; unlinked nodes are freed only once
+ *   no producer can still be looking at them.
+ *
+ * Entries with equal deadlines are popped in insertion order.
+ *
+ * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
+ *
+ * @tparam T The value stored with every deadline.
+ */
+template<typename T>
+class ConcurrentSkipList {
+    static constexpr size_t kMaxLevel = 12; ///< With a branching factor of 4, enough for tens of millions of entries.
+
+    struct Node {
+	int64_t key;
+	uint64_t sequence;
+	T value;
+	size_t level;
+	std::atomic<bool> linked = false; ///< Set once the node is linked at every level.
+	std::atomic<uintptr_t> next[kMaxLevel] = {}; ///< Forward pointers; the low bit marks the node as removed.
+    };
+
+public:
+    ConcurrentSkipList()
+	: head_{new Node { .key = 0, .sequence = 0, .value = T{}, .level = kMaxLevel }}
+    {}
+
+    /**
+     * @brief Destroys every remaining entry. No other thread may use the list anymore.
+     */
+    ~ConcurrentSkipList() {
+	for (auto* node = head_; node;) {
+	    auto* next = Pointer(node->next[0].load());
+	    delete node;
+	    node = next;
+	}
+    }
+
+    ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+    ConcurrentSkipList(const ConcurrentSkipList&&) = delete;
+    ConcurrentSkipList& operator=(const ConcurrentSkipList&)= delete;
+    ConcurrentSkipList& operator=(ConcurrentSkipList&&) = delete;
+
+    /**
+     * @brief Adds a value with its deadline. Safe to call from any number of threads at once.
+     */
+    void Insert(int64_t deadline, T value) {
+	auto* node = new Node {
+	    .key = deadline,
+	    .sequence = sequence_.fetch_add(1, std::memory_order_relaxed),
+	    .value = std::move(value),
+	    .level = RandomLevel(),
+	};
+
+	typename EpochReclaimer<Node>::Guard guard(reclaimer_);
+	Node* preds[kMaxLevel];
+	Node* succs[kMaxLevel];
+
+	for (size_t level = 0; level < node->level;) {
+	    Find(node, preds, succs);
+	    node->next[level].store(Tag(succs[level]), std::memory_order_relaxed);
+
+	    auto expected = Tag(succs[level]);
+	    if (preds[level]->next[level].compare_exchange_strong(expected, Tag(node))) {
+		++level;
+	    } else {
+		CpuRelax();
+	    }
+	}
+	node->linked.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Removes every value whose deadline is not later than `now` and passes it to `fn`, earliest first.
+     *
+     * Must only be called by the single consumer thread. An entry whose producer is still linking it is left for
+     * the next call.
+     */
+    template<typename F>
+    void PopExpired(int64_t now, F&& fn) {
+	size_t popped = 0;
+
+	for (;;) {
+	    auto* front = Pointer(head_->next[0].load());
+	    if (!front || front->key > now || !front->linked.load(std::memory_order_acquire)) {
+		break;
+	    }
+
+	    Unlink(front);
+	    fn(std::move(front->value));
+	    reclaimer_.Retire(front);
+	    ++popped;
+	}
+
+	if (popped) {
+	    reclaimer_.TryAdvance();
+	}
+    }
+
+    /**
+     * @brief Returns the earliest deadline in the list, or the maximum representable one if there is none.
+     *
+     * Must only be called by the single consumer thread, which is the only one removing, and thus freeing, nodes.
+     */
+    int64_t NextDeadline() const noexcept {
+	auto* front = Pointer(head_->next[0].load());
+	return front ? front->key : std::numeric_limits<int64_t>::max();
+    }
+
+    /**
+     * @brief Checks whether the list holds no entry.
+     */
+    bool Empty() const noexcept {
+	return head_->next[0].load() == 0;
+    }
+
+private:
+    static Node* Pointer(uintptr_t tagged) noexcept {
+	return reinterpret_cast<Node*>(tagged & ~uintptr_t{1});
+    }
+
+    static uintptr_t Tag(Node* node) noexcept {
+	return reinterpret_cast<uintptr_t>(node);
+    }
+
+    static bool Less(const Node* lhs, const Node* rhs) noexcept {
+	return lhs->key < rhs->key || (lhs->key == rhs->key && lhs->sequence < rhs->sequence);
+    }
+
+    static size_t RandomLevel() noexcept {
+	static thread_local uint64_t state = reinterpret_cast<uintptr_t>(&state) | 1;
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return std::min<size_t>(1 + std::countr_zero(state | (uint64_t{1} << 62)) / 2, kMaxLevel);
+    }
+
+    /**
+     * @brief Finds, at every level, the last node ordered before `node` and the node following it.
+     */
+    void Find(const Node* node, Node** preds, Node** succs) const noexcept {
+	auto* pred = head_;
+	for (size_t level = kMaxLevel; level-- > 0;) {
+	    auto* curr = Pointer(pred->next[level].load());
+	    while (curr && Less(curr, node)) {
+		pred = curr;
+		curr = Pointer(curr->next[level].load());
+	    }
+	    preds[level] = pred;
+	    succs[level] = curr;
+	}
+    }
+
+    /**
+     * @brief Marks the front node as removed and unlinks it at every level.
+     */
+    void Unlink(Node* front) noexcept {
+	for (size_t level = front->level; level-- > 0;) {
+	    front->next[level].fetch_or(1);
+	}
+
+	for (size_t level = front->level; level-- > 0;) {
+	    for (;;) {
+		// Producers may have linked smaller entries in front of the node meanwhile.
+		auto* pred = head_;
+		auto* curr = Pointer(pred->next[level].load());
+		while (curr != front && Less(curr, front)) {
+		    pred = curr;
+		    curr = Pointer(curr->next[level].load());
+		}
+
+		auto expected = Tag(front);
+		if (pred->next[level].compare_exchange_strong(expected, Tag(Pointer(front->next[level].load())))) {
+		    break;
+		}
+	    }
+	}
+    }
+
+    Node* head_;
+    std::atomic<uint64_t> sequence_ = 0;
+    mutable EpochReclaimer<Node> reclaimer_;
+};
+
+} // namespace internal
+} // namespace scheduler
@@ -0,0 +1,224 @@
+/**
+ * @file deadline_array.h
+ * @brief Header file for the DeadlineArray class and its expiry scan kernels.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SCHEDULER_SIMD_X86 1
+#endif
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Kernels finding the indices of expired deadlines, i.e. deadlines not later than `now`.
+ *
+ * Every kernel writes the indices of expired entries to `out` in ascending order and returns their number.
+ * `out` must have room for `size + kScanSlack` indices, as vector kernels store whole lanes.
+ */
+namespace scan {
+
+inline constexpr size_t kScanSlack = 8;
+
+using Kernel = size_t (*)(const int64_t* deadlines, size_t size, int64_t now, uint32_t* out);
+
+/**
+ * @brief Scalar scan of the range [begin, end), also used by the vector kernels for their tail.
+ */
+inline size_t ScanRange(const int64_t* deadlines, size_t begin, size_t end, int64_t now, uint32_t* out) {
+    size_t count = 0;
+    for (size_t i = begin; i < end; ++i) {
+	// Branchless: the index is always stored and only kept if the deadline has expired.
+	out[count] = static_cast<uint32_t>(i);
+	count += deadlines[i] <= now;
+    }
+    return count;
+}
+
+inline size_t ScanScalar(const int64_t* deadlines, size_t size, int64_t now, uint32_t* out) {
+    return ScanRange(deadlines, 0, size, now, out);
+}
+
+#ifdef SCHEDULER_SIMD_X86
+__attribute__((target("avx2")))
+inline size_t ScanAvx2(const int64_t* deadlines, size_t size, int64_t now, uint32_t* out) {
+    auto limit = _mm256_set1_epi64x(now);
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+	auto values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(deadlines + i));
+	auto later = _mm256_cmpgt_epi64(values, limit);
+	unsigned mask = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(later))) & 0xF;
+
+	while (mask) {
+	    out[count++] = static_cast<uint32_t>(i + __builtin_ctz(mask));
+	    mask &= mask - 1;
+	}
+    }
+
+    return count + ScanRange(deadlines, i, size, now, out + count);
+}
+
+__attribute__((target("avx512f")))
+inline size_t ScanAvx512(const int64_t* deadlines, size_t size, int64_t now, uint32_t* out) {
+    auto limit = _mm512_set1_epi64(now);
+    auto indices = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+    auto step = _mm512_set1_epi64(8);
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+	auto values = _mm512_loadu_si512(deadlines + i);
+	__mmask8 mask = _mm512_cmple_epi64_mask(values, limit);
+
+	if (mask) {
+	    auto packed = _mm512_cvtepi64_epi32(_mm512_maskz_compress_epi64(mask, indices));
+	    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), packed);
+	    count += __builtin_popcount(mask);
+	}
+	indices = _mm512_add_epi64(indices, step);
+    }
+
+    return count + ScanRange(deadlines, i, size, now, out + count);
+}
+#endif
+
+/**
+ * @brief Picks the widest kernel the CPU supports, once per process.
+ */
+inline Kernel Select() noexcept {
+#ifdef SCHEDULER_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+	return ScanAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+	return ScanAvx2;
+    }
+#endif
+    return ScanScalar;
+}
+
+/**
+ * @brief Runs the kernel chosen by `Select`.
+ */
+inline size_t ScanExpired(const int64_t* deadlines, size_t size, int64_t now, uint32_t* out) {
+    static const Kernel kernel = Select();
+    return kernel(deadlines, size, now, out);
+}
+
+} // namespace scan
+
+/**
+ * @brief Unordered timer store keeping deadlines in a dense array, separate from the values they belong to.
+ *
+ * @details
+ * A scan for expired entries only reads the deadline array, eight bytes per entry, instead of dragging every
+ * value, e.g. a `std::function`, through the cache. The scan runs an AVX-512 or AVX2 compare-and-compress
+ * kernel when the CPU supports one and a branchless scalar loop otherwise.
+ *
+ * Expired entries are removed by moving the last entry into their place, so insertion and removal are O(1)
+ * and the values are never moved in bulk.
+ *
+ * @tparam T The value stored with every deadline.
+ */
+template<typename T>
+class DeadlineArray {
+public:
+    /**
+     * @brief Adds a value with its deadline.
+     */
+    void Push(int64_t deadline, T value) {
+	deadlines_.push_back(deadline);
+	values_.push_back(std::move(value));
+	next_ = std::min(next_, deadline);
+    }
+
+    /**
+     * @brief Removes every value whose deadline is not later than `now` and passes it to `fn`.
+     *
+     * @param now The current time, in the same unit as the deadlines.
+     * @param fn Called with an rvalue reference to every expired value, in no particular order.
+     */
+    template<typename F>
+    void PopExpired(int64_t now, F&& fn) {
+	expired_.resize(deadlines_.size() + scan::kScanSlack);
+	auto count = scan::ScanExpired(deadlines_.data(), deadlines_.size(), now, expired_.data());
+	next_valid_ = next_valid_ && !count;
+
+	// Descending order: the last entry moved into a hole is never an expired entry still to be visited.
+	while (count) {
+	    auto index = expired_[--count];
+	    fn(std::move(values_[index]));
+
+	    if (index + 1 != values_.size()) {
+		deadlines_[index] = deadlines_.back();
+		values_[index] = std::move(values_.back());
+	    }
+	    deadlines_.pop_back();
+	    values_.pop_back();
+	}
+    }
+
+    /**
+     * @brief Removes up to `max` values regardless of their deadlines and passes each to `fn` with its deadline.
+     */
+    template<typename F>
+    void Extract(size_t max, F&& fn) {
+	next_valid_ = false;
+	for (; max && !values_.empty(); --max) {
+	    fn(deadlines_.back(), std::move(values_.back()));
+	    deadlines_.pop_back();
+	    values_.pop_back();
+	}
+    }
+
+    /**
+     * @brief Returns the earliest stored deadline, or the maximum representable one if there is none.
+     *
+     * The minimum is kept up to date by `Push` and only rescanned after values have been removed.
+     */
+    int64_t NextDeadline() noexcept {
+	if (!next_valid_) {
+	    auto min = std::min_element(deadlines_.begin(), deadlines_.end());
+	    next_ = min == deadlines_.end() ? std::numeric_limits<int64_t>::max() : *min;
+	    next_valid_ = true;
+	}
+	return next_;
+    }
+
+    /**
+     * @brief Returns the number of stored values.
+     */
+    size_t Size() const noexcept {
+	return deadlines_.size();
+    }
+
+    /**
+     * @brief Checks whether no value is stored.
+     */
+    bool Empty() const noexcept {
+	return deadlines_.empty();
+    }
+
+private:
+    std::vector<int64_t> deadlines_;
+    std::vector<T> values_;
+    std::vector<uint32_t> expired_;
+    int64_t next_ = std::numeric_limits<int64_t>::max();
+    bool next_valid_ = true;
+};
+
+} // namespace internal
+} // namespace scheduler
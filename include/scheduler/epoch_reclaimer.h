@@ -0,0 +1,117 @@
+/**
+ * @file epoch_reclaimer.h
+ * @brief Header file for the EpochReclaimer class.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Epoch-based memory reclamation for lock-free structures with many readers and a single reclaiming thread.
+ *
+ * @details
+ * Readers wrap every traversal in a `Guard`, which registers them with the current global epoch. The reclaiming
+ * thread hands unlinked nodes to `Retire`; a node retired during epoch `e` can only be referenced by readers that
+ * entered in epoch `e` or earlier. The epoch advances once no reader of the previous epoch is left, and at that
+ * point everything retired two epochs ago is freed.
+ *
+ * Readers are counted per epoch rather than registered per thread, so any thread can read without registering
+ * first; three epochs are in flight at most, hence three counters and three limbo lists.
+ *
+ * @tparam Node The type of the retired nodes, freed with `delete`.
+ */
+template<typename Node>
+class EpochReclaimer {
+public:
+    /**
+     * @class Guard
+     * @brief Keeps nodes retired from now on alive while the guard exists.
+     */
+    class Guard {
+    public:
+	explicit Guard(EpochReclaimer& reclaimer) noexcept
+	    : reclaimer_{reclaimer}
+	{
+	    for (;;) {
+		epoch_ = reclaimer_.epoch_.load();
+		reclaimer_.readers_[epoch_ % 3].fetch_add(1);
+		if (reclaimer_.epoch_.load() == epoch_) {
+		    return;
+		}
+		reclaimer_.readers_[epoch_ % 3].fetch_sub(1);
+	    }
+	}
+
+	~Guard() {
+	    reclaimer_.readers_[epoch_ % 3].fetch_sub(1, std::memory_order_release);
+	}
+
+	Guard(const Guard&) = delete;
+	Guard& operator=(const Guard&) = delete;
+
+    private:
+	EpochReclaimer& reclaimer_;
+	uint64_t epoch_;
+    };
+
+    EpochReclaimer() = default;
+
+    /**
+     * @brief Frees every retired node. No reader may be active anymore.
+     */
+    ~EpochReclaimer() {
+	for (auto& limbo: limbo_) {
+	    Free(limbo);
+	}
+    }
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer(const EpochReclaimer&&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&)= delete;
+    EpochReclaimer& operator=(EpochReclaimer&&) = delete;
+
+    /**
+     * @brief Schedules an unlinked node for deletion. Called by the reclaiming thread only.
+     */
+    void Retire(Node* node) {
+	limbo_[epoch_.load() % 3].push_back(node);
+    }
+
+    /**
+     * @brief Advances the epoch if every reader of the previous one has left, freeing what was retired before it.
+     *
+     * Called by the reclaiming thread only, typically after a batch of `Retire` calls.
+     */
+    void TryAdvance() {
+	auto epoch = epoch_.load();
+	if (epoch && readers_[(epoch - 1) % 3].load() != 0) {
+	    return;
+	}
+
+	epoch_.store(epoch + 1);
+	Free(limbo_[(epoch + 2) % 3]);
+    }
+
+private:
+    static void Free(std::vector<Node*>& limbo) {
+	for (auto* node: limbo) {
+	    delete node;
+	}
+	limbo.clear();
+    }
+
+    std::atomic<uint64_t> epoch_ = 0;
+    std::array<std::atomic<size_t>, 3> readers_{};
+    std::array<std::vector<Node*>, 3> limbo_;
+};
+
+} // namespace internal
+} // namespace scheduler
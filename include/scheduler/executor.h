@@ -0,0 +1,55 @@
+/**
+ * @file executor.h
+ * @brief Header file for the Executor interface.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace scheduler {
+
+/**
+ * @struct PoolMetrics
+ * @brief A snapshot of an executor's counters.
+ */
+struct PoolMetrics {
+    size_t submitted = 0; ///< Tasks handed to the executor so far.
+    size_t completed = 0; ///< Tasks the executor has finished executing.
+    size_t queued = 0; ///< Tasks waiting for a worker.
+    size_t threads = 0; ///< Worker threads currently alive.
+    size_t peak_threads = 0; ///< The largest number of worker threads alive at once.
+};
+
+/**
+ * @class Executor
+ * @brief Interface of anything a `Scheduler` can dispatch expired tasks into.
+ *
+ * The built-in `ThreadPool` and `BlockingPool` implement it, but an application can pass its own implementation,
+ * or share one pool between many schedulers, instead of letting every scheduler spawn threads of its own.
+ * An executor passed to a scheduler from outside is never started or shut down by the scheduler; its lifecycle
+ * belongs to the caller.
+ */
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    /**
+     * @brief Schedules a task for execution.
+     *
+     * @param task The task to execute.
+     *
+     * @note Must be safe to call from several threads at once, as several schedulers may share one executor.
+     */
+    virtual void Execute(std::function<void()> task) = 0;
+
+    /**
+     * @brief Returns a snapshot of the executor's counters. Executors without counters report zeros.
+     */
+    virtual PoolMetrics Metrics() const {
+	return {};
+    }
+};
+
+} // namespace scheduler
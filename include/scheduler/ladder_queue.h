@@ -0,0 +1,271 @@
+/**
+ * @file ladder_queue.h
+ * @brief Header file for the LadderQueue class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Priority queue of deadlines for very wide deadline ranges: a ladder queue.
+ *
+ * @details
+ * A ladder queue is a self-tuning calendar queue made of three tiers:
+ *
+ * - **Top**: an unsorted vector of far-future entries. Insertion is a plain `push_back`.
+ * - **Rungs**: calendars of buckets. When the rungs run dry, the whole top is spread over a new rung whose bucket
+ *   width is derived from the top's deadline span. When the next bucket of a rung holds too many entries, it is
+ *   spread over a finer rung beneath instead of being sorted.
+ * - **Bottom**: a short sorted vector of the nearest deadlines, filled from the next bucket of the finest rung.
+ *
+ * Entries are only ever sorted in small groups once they are near, which makes insertion and extraction O(1)
+ * amortized whether deadlines are milliseconds or months away.
+ *
+ * @tparam T The value stored with every deadline.
+ */
+template<typename T>
+class LadderQueue {
+public:
+    /**
+     * @brief Adds a value with its deadline.
+     */
+    void Push(int64_t deadline, T value) {
+	++size_;
+
+	// Without rungs, anything after the bottom can go to the top, which keeps sorted insertions into the bottom rare.
+	bool after_bottom = rungs_.empty() && (bottom_.empty() || deadline >= bottom_.front().key);
+	if (deadline >= top_start_ || after_bottom) {
+	    top_min_ = std::min(top_min_, deadline);
+	    top_max_ = std::max(top_max_, deadline);
+	    top_.push_back(Entry { .key = deadline, .value = std::move(value) });
+	    return;
+	}
+
+	for (auto& rung: rungs_) {
+	    if (deadline >= rung.CurrentStart()) {
+		rung.buckets[rung.Index(deadline)].push_back(Entry { .key = deadline, .value = std::move(value) });
+		return;
+	    }
+	}
+
+	// The bottom is sorted in descending order, so the earliest deadline is popped from its back.
+	auto it = std::upper_bound(bottom_.begin(), bottom_.end(), deadline, [](int64_t key, const Entry& entry) {
+	    return key > entry.key;
+	});
+	bottom_.insert(it, Entry { .key = deadline, .value = std::move(value) });
+    }
+
+    /**
+     * @brief Removes every value whose deadline is not later than `now` and passes it to `fn`.
+     *
+     * @param now The current time, in the same unit as the deadlines.
+     * @param fn Called with an rvalue reference to every expired value, in deadline order.
+     */
+    template<typename F>
+    void PopExpired(int64_t now, F&& fn) {
+	while (size_) {
+	    if (bottom_.empty() && !Refill()) {
+		return;
+	    }
+
+	    while (!bottom_.empty() && bottom_.back().key <= now) {
+		auto value = std::move(bottom_.back().value);
+		bottom_.pop_back();
+		--size_;
+		fn(std::move(value));
+	    }
+
+	    if (!bottom_.empty()) {
+		return;
+	    }
+	}
+    }
+
+    /**
+     * @brief Removes up to `max` values regardless of their deadlines and passes each to `fn` with its deadline.
+     *
+     * The top goes first, then the rungs from the coarsest one, then the bottom, so the latest deadlines tend to
+     * leave first.
+     */
+    template<typename F>
+    void Extract(size_t max, F&& fn) {
+	auto extract = [&](std::vector<Entry>& entries) {
+	    for (; max && !entries.empty(); --max) {
+		fn(entries.back().key, std::move(entries.back().value));
+		entries.pop_back();
+		--size_;
+	    }
+	};
+
+	extract(top_);
+	for (auto& rung: rungs_) {
+	    for (auto bucket = rung.buckets.rbegin(); bucket != rung.buckets.rend(); ++bucket) {
+		extract(*bucket);
+	    }
+	}
+	extract(bottom_);
+
+	if (!size_) {
+	    rungs_.clear();
+	    ResetTop();
+	}
+    }
+
+    /**
+     * @brief Returns the earliest stored deadline, or the maximum representable one if there is none.
+     *
+     * The bottom always holds the earliest deadlines, so this only has to refill an empty bottom, as `PopExpired`
+     * would, and look at its end.
+     */
+    int64_t NextDeadline() {
+	if (bottom_.empty() && !Refill()) {
+	    return std::numeric_limits<int64_t>::max();
+	}
+	return bottom_.back().key;
+    }
+
+    /**
+     * @brief Returns the number of stored values.
+     */
+    size_t Size() const noexcept {
+	return size_;
+    }
+
+    /**
+     * @brief Checks whether no value is stored.
+     */
+    bool Empty() const noexcept {
+	return size_ == 0;
+    }
+
+private:
+    struct Entry {
+	int64_t key;
+	T value;
+    };
+
+    /**
+     * @struct Rung
+     * @brief A calendar of equally wide buckets, consumed from `current` onwards.
+     */
+    struct Rung {
+	int64_t start = 0;
+	int64_t width = 1;
+	size_t current = 0;
+	std::vector<std::vector<Entry>> buckets = {};
+
+	int64_t CurrentStart() const noexcept {
+	    return start + static_cast<int64_t>(current) * width;
+	}
+
+	size_t Index(int64_t key) const noexcept {
+	    return std::min(static_cast<size_t>((key - start) / width), buckets.size() - 1);
+	}
+    };
+
+    static constexpr size_t kBuckets = 64; ///< The number of buckets of a rung spawned from the top.
+    static constexpr size_t kThreshold = 64; ///< Buckets larger than this are spread over a new rung, not sorted.
+    static constexpr size_t kMaxRungs = 8;
+
+    /**
+     * @brief Fills the empty bottom with the next non-empty bucket, spawning rungs as needed.
+     *
+     * @return False if the queue is empty.
+     */
+    bool Refill() {
+	for (;;) {
+	    while (!rungs_.empty()) {
+		auto& rung = rungs_.back();
+		while (rung.current < rung.buckets.size() && rung.buckets[rung.current].empty()) {
+		    ++rung.current;
+		}
+		if (rung.current < rung.buckets.size()) {
+		    break;
+		}
+		rungs_.pop_back();
+	    }
+
+	    if (rungs_.empty()) {
+		if (top_.empty()) {
+		    ResetTop();
+		    return false;
+		}
+		SpawnFromTop();
+		continue;
+	    }
+
+	    auto& rung = rungs_.back();
+	    auto& bucket = rung.buckets[rung.current];
+	    auto bucket_start = rung.CurrentStart();
+	    auto width = rung.width;
+	    ++rung.current;
+
+	    if (bucket.size() > kThreshold && width > 1 && rungs_.size() < kMaxRungs) {
+		auto entries = std::move(bucket);
+		bucket.clear();
+		auto child_width = (width + kBuckets - 1) / static_cast<int64_t>(kBuckets);
+		SpawnRung(bucket_start, child_width, static_cast<size_t>((width + child_width - 1) / child_width), entries);
+		continue;
+	    }
+
+	    bottom_ = std::move(bucket);
+	    bucket.clear();
+	    std::sort(bottom_.begin(), bottom_.end(), [](const Entry& lhs, const Entry& rhs) { return lhs.key > rhs.key; });
+	    return true;
+	}
+    }
+
+    /**
+     * @brief Spreads the whole top over a new coarsest rung; later deadlines than the top's current ones go to the top.
+     */
+    void SpawnFromTop() {
+	auto span = static_cast<uint64_t>(top_max_) - static_cast<uint64_t>(top_min_) + 1;
+	auto width = static_cast<int64_t>(std::max<uint64_t>((span + kBuckets - 1) / kBuckets, 1));
+	auto start = top_min_;
+	auto entries = std::move(top_);
+	top_.clear();
+
+	top_start_ = top_max_ == std::numeric_limits<int64_t>::max() ? top_max_ : top_max_ + 1;
+	top_min_ = std::numeric_limits<int64_t>::max();
+	top_max_ = std::numeric_limits<int64_t>::min();
+
+	SpawnRung(start, width, static_cast<size_t>((span + width - 1) / width), entries);
+    }
+
+    void SpawnRung(int64_t start, int64_t width, size_t buckets, std::vector<Entry>& entries) {
+	auto& rung = rungs_.emplace_back(Rung { .start = start, .width = width });
+	rung.buckets.resize(buckets);
+	for (auto& entry: entries) {
+	    rung.buckets[rung.Index(entry.key)].push_back(std::move(entry));
+	}
+    }
+
+    /**
+     * @brief Lets every new deadline go to the top again once the rungs and the bottom are empty.
+     */
+    void ResetTop() noexcept {
+	top_start_ = std::numeric_limits<int64_t>::min();
+	top_min_ = std::numeric_limits<int64_t>::max();
+	top_max_ = std::numeric_limits<int64_t>::min();
+    }
+
+    std::vector<Entry> top_;
+    int64_t top_start_ = std::numeric_limits<int64_t>::min();
+    int64_t top_min_ = std::numeric_limits<int64_t>::max();
+    int64_t top_max_ = std::numeric_limits<int64_t>::min();
+    std::vector<Rung> rungs_; ///< From the coarsest rung at the front to the finest one at the back.
+    std::vector<Entry> bottom_;
+    size_t size_ = 0;
+};
+
+} // namespace internal
+} // namespace scheduler
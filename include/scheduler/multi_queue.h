@@ -0,0 +1,210 @@
+/**
+ * @file multi_queue.h
+ * @brief Header file for the MultiQueue class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Relaxed concurrent priority queue of deadlines: a MultiQueue.
+ *
+ * @details
+ * The queue is split into `queues` independent binary heaps, each behind its own lock. `Insert` pushes into
+ * a random heap; a pop samples two random heaps and takes the smaller of their minimums. Threads therefore
+ * rarely touch the same lock, and any number of them can insert and pop at once.
+ *
+ * The price is ordering: a pop returns one of the smallest entries rather than the smallest one. The expected
+ * rank error grows linearly with the number of heaps, which is the relaxation bound: one heap gives a strict
+ * priority queue, and two heaps per popping thread is the usual trade-off.
+ *
+ * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
+ *
+ * @tparam T The value stored with every deadline.
+ */
+template<typename T>
+class MultiQueue {
+public:
+    /**
+     * @brief Constructs a MultiQueue.
+     * @param queues The number of heaps, i.e. the relaxation bound.
+     */
+    explicit MultiQueue(size_t queues)
+	: heaps_(std::max<size_t>(queues, 1))
+    {}
+
+    MultiQueue(const MultiQueue&) = delete;
+    MultiQueue(const MultiQueue&&) = delete;
+    MultiQueue& operator=(const MultiQueue&)= delete;
+    MultiQueue& operator=(MultiQueue&&) = delete;
+
+    /**
+     * @brief Adds a value with its deadline. Safe to call from any number of threads at once.
+     */
+    void Insert(int64_t deadline, T value) {
+	for (;;) {
+	    auto& heap = heaps_[Random() % heaps_.size()];
+	    std::unique_lock lock(heap.mutex, std::try_to_lock);
+	    if (!lock) {
+		continue;
+	    }
+
+	    heap.entries.push_back(Entry { .key = deadline, .value = std::move(value) });
+	    std::push_heap(heap.entries.begin(), heap.entries.end(), Later);
+	    heap.top.store(heap.entries.front().key, std::memory_order_release);
+	    return;
+	}
+    }
+
+    /**
+     * @brief Pops one value whose deadline is not later than `now`, among the smallest ones.
+     *
+     * @param now The current time, in the same unit as the deadlines.
+     * @param out Receives the popped value.
+     * @return True if a value was popped; false if the sampled heaps had nothing expired or were busy.
+     *
+     * Safe to call from any number of threads at once.
+     */
+    bool TryPop(int64_t now, T& out) {
+	auto& first = heaps_[Random() % heaps_.size()];
+	auto& second = heaps_[Random() % heaps_.size()];
+	auto& heap = first.top.load(std::memory_order_relaxed) <= second.top.load(std::memory_order_relaxed) ? first : second;
+
+	if (heap.top.load(std::memory_order_acquire) > now) {
+	    return false;
+	}
+
+	std::unique_lock lock(heap.mutex, std::try_to_lock);
+	if (!lock || heap.entries.empty() || heap.entries.front().key > now) {
+	    return false;
+	}
+
+	Pop(heap, out);
+	return true;
+    }
+
+    /**
+     * @brief Pops every value whose deadline is not later than `now` and passes it to `fn`.
+     *
+     * @return The number of values popped.
+     *
+     * Values are sampled as in `TryPop` until `kMaxMisses` samples in a row found nothing. Sampling misses heaps
+     * once only a few of them hold expired values, so it is followed by a sweep over every heap that waits for
+     * each lock; values inserted meanwhile aside, nothing expired is left behind when it returns.
+     */
+    template<typename F>
+    size_t PopExpired(int64_t now, F&& fn) {
+	size_t popped = 0;
+	T value;
+	for (size_t misses = 0; misses < kMaxMisses;) {
+	    if (TryPop(now, value)) {
+		fn(std::move(value));
+		++popped;
+		misses = 0;
+	    } else {
+		++misses;
+	    }
+	}
+
+	for (auto& heap: heaps_) {
+	    while (heap.top.load(std::memory_order_acquire) <= now) {
+		std::unique_lock lock(heap.mutex);
+		if (heap.entries.empty() || heap.entries.front().key > now) {
+		    break;
+		}
+		Pop(heap, value);
+		lock.unlock();
+		fn(std::move(value));
+		++popped;
+	    }
+	}
+	return popped;
+    }
+
+    /**
+     * @brief Returns the earliest deadline among the heaps' minimums, or the maximum representable one if all are empty.
+     *
+     * Exact only while no other thread inserts or pops.
+     */
+    int64_t NextDeadline() const noexcept {
+	auto next = kNone;
+	for (auto& heap: heaps_) {
+	    next = std::min(next, heap.top.load(std::memory_order_acquire));
+	}
+	return next;
+    }
+
+    /**
+     * @brief Checks whether every heap is empty. Exact only while no other thread inserts or pops.
+     */
+    bool Empty() const noexcept {
+	return std::all_of(heaps_.begin(), heaps_.end(), [](const Heap& heap) {
+	    return heap.top.load(std::memory_order_acquire) == kNone;
+	});
+    }
+
+    /**
+     * @brief Returns the number of heaps, i.e. the relaxation bound.
+     */
+    size_t Queues() const noexcept {
+	return heaps_.size();
+    }
+
+private:
+    struct Entry {
+	int64_t key;
+	T value;
+    };
+
+    /**
+     * @struct Heap
+     * @brief One of the heaps, padded to its own cache line. `top` mirrors the minimum for lock-free sampling.
+     */
+    struct alignas(64) Heap {
+	std::mutex mutex;
+	std::vector<Entry> entries;
+	std::atomic<int64_t> top = kNone;
+    };
+
+    static constexpr int64_t kNone = std::numeric_limits<int64_t>::max();
+    static constexpr size_t kMaxMisses = 8;
+
+    static bool Later(const Entry& lhs, const Entry& rhs) noexcept {
+	return lhs.key > rhs.key;
+    }
+
+    /**
+     * @brief Moves the minimum of a non-empty heap to `out`. Must be called under the heap's lock.
+     */
+    static void Pop(Heap& heap, T& out) {
+	std::pop_heap(heap.entries.begin(), heap.entries.end(), Later);
+	out = std::move(heap.entries.back().value);
+	heap.entries.pop_back();
+	heap.top.store(heap.entries.empty() ? kNone : heap.entries.front().key, std::memory_order_release);
+    }
+
+    static uint64_t Random() noexcept {
+	static thread_local uint64_t state = reinterpret_cast<uintptr_t>(&state) | 1;
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+    }
+
+    std::vector<Heap> heaps_;
+};
+
+} // namespace internal
+} // namespace scheduler
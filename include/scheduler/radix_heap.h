@@ -0,0 +1,192 @@
+/**
+ * @file radix_heap.h
+ * @brief Header file for the RadixHeap class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Monotone priority queue of deadlines: a radix heap.
+ *
+ * @details
+ * A radix heap relies on the keys it extracts never decreasing, which holds for a timer store: it only ever
+ * pops deadlines up to "now", and "now" does not go backwards. Entries live in 65 buckets; bucket `i` holds keys
+ * that first differ from the last extracted key in bit `i - 1`. Only the first non-empty bucket is ever
+ * redistributed, into lower buckets, so every entry moves at most 64 times over its lifetime: insertion is O(1)
+ * and extraction is amortized O(log C), C being the spread of the deadlines. Buckets are plain vectors scanned
+ * front to back, which is far kinder to the cache than the pointer chasing of a comparison heap.
+ *
+ * A deadline earlier than the last extracted one is treated as equal to it, i.e. as already expired.
+ *
+ * @tparam T The value stored with every deadline.
+ */
+template<typename T>
+class RadixHeap {
+public:
+    /**
+     * @brief Adds a value with its deadline.
+     */
+    void Push(int64_t deadline, T value) {
+	auto key = std::max(Key(deadline), last_);
+	buckets_[Bucket(key)].push_back(Entry { .key = key, .value = std::move(value) });
+
+	// A stale minimum left behind by the last value removed must not survive into a new one.
+	next_ = ++size_ == 1 ? key : std::min(next_, key);
+    }
+
+    /**
+     * @brief Removes every value whose deadline is not later than `now` and passes it to `fn`.
+     *
+     * @param now The current time, in the same unit as the deadlines.
+     * @param fn Called with an rvalue reference to every expired value, in deadline order.
+     */
+    template<typename F>
+    void PopExpired(int64_t now, F&& fn) {
+	auto limit = Key(now);
+
+	while (size_) {
+	    // A known minimum answers a poll with nothing due without scanning the first bucket for it.
+	    if (next_valid_ && next_ > limit) {
+		return;
+	    }
+	    if (buckets_[0].empty() && !Redistribute(limit)) {
+		return;
+	    }
+
+	    // Bucket 0 only holds keys equal to `last_`, which is not later than `limit`.
+	    auto& bucket = buckets_[0];
+	    size_ -= bucket.size();
+	    next_valid_ = false;
+	    for (auto& entry: bucket) {
+		fn(std::move(entry.value));
+	    }
+	    bucket.clear();
+	}
+    }
+
+    /**
+     * @brief Removes up to `max` values regardless of their deadlines and passes each to `fn` with its deadline.
+     *
+     * The latest deadlines go first, as they are the ones furthest from being extracted anyway.
+     */
+    template<typename F>
+    void Extract(size_t max, F&& fn) {
+	for (auto bucket = buckets_.rbegin(); max && bucket != buckets_.rend(); ++bucket) {
+	    for (; max && !bucket->empty(); --max) {
+		// Rescanning for the minimum costs a whole bucket, so a migration in batches only does it when needed.
+		next_valid_ = next_valid_ && bucket->back().key != next_;
+		fn(Deadline(bucket->back().key), std::move(bucket->back().value));
+		bucket->pop_back();
+		--size_;
+	    }
+	}
+    }
+
+    /**
+     * @brief Returns the earliest stored deadline, or the maximum representable one if there is none.
+     *
+     * The minimum is kept up to date by `Push` and by a `PopExpired` that stops at an unexpired bucket; only after
+     * values have been removed otherwise is the first non-empty bucket scanned again.
+     */
+    int64_t NextDeadline() noexcept {
+	if (!next_valid_) {
+	    next_ = std::numeric_limits<uint64_t>::max();
+	    for (auto& bucket: buckets_) {
+		if (!bucket.empty()) {
+		    for (auto& entry: bucket) {
+			next_ = std::min(next_, entry.key);
+		    }
+		    break;
+		}
+	    }
+	    next_valid_ = true;
+	}
+	return size_ ? Deadline(next_) : std::numeric_limits<int64_t>::max();
+    }
+
+    /**
+     * @brief Returns the number of stored values.
+     */
+    size_t Size() const noexcept {
+	return size_;
+    }
+
+    /**
+     * @brief Checks whether no value is stored.
+     */
+    bool Empty() const noexcept {
+	return size_ == 0;
+    }
+
+private:
+    struct Entry {
+	uint64_t key;
+	T value;
+    };
+
+    /**
+     * @brief Maps a signed deadline onto an unsigned key of the same order.
+     */
+    static uint64_t Key(int64_t deadline) noexcept {
+	return static_cast<uint64_t>(deadline) ^ (uint64_t{1} << 63);
+    }
+
+    static int64_t Deadline(uint64_t key) noexcept {
+	return static_cast<int64_t>(key ^ (uint64_t{1} << 63));
+    }
+
+    size_t Bucket(uint64_t key) const noexcept {
+	return key == last_ ? 0 : std::bit_width(key ^ last_);
+    }
+
+    /**
+     * @brief Moves the minimum of the first non-empty bucket into `last_` and spreads that bucket over lower ones.
+     *
+     * @return False, without touching anything, if the minimum is later than `limit`.
+     */
+    bool Redistribute(uint64_t limit) {
+	size_t index = 1;
+	while (buckets_[index].empty()) {
+	    ++index;
+	}
+
+	auto& bucket = buckets_[index];
+	auto min = bucket.front().key;
+	for (auto& entry: bucket) {
+	    min = std::min(min, entry.key);
+	}
+	if (min > limit) {
+	    next_ = min;
+	    next_valid_ = true;
+	    return false;
+	}
+
+	last_ = min;
+	for (auto& entry: bucket) {
+	    buckets_[Bucket(entry.key)].push_back(std::move(entry));
+	}
+	bucket.clear();
+	return true;
+    }
+
+    std::array<std::vector<Entry>, 65> buckets_;
+    uint64_t last_ = 0;
+    size_t size_ = 0;
+    uint64_t next_ = std::numeric_limits<uint64_t>::max(); ///< The smallest key, while `next_valid_` is set.
+    bool next_valid_ = true;
+};
+
+} // namespace internal
+} // namespace scheduler
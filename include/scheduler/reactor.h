@@ -0,0 +1,372 @@
+/**
+ * @file reactor.h
+ * @brief Header file for the Reactor class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "circular_buffer.h"
+#include "wait_strategy.h"
+
+namespace scheduler {
+using namespace internal;
+
+/**
+ * @class Reactor
+ * @brief A shared-nothing scheduler: every worker thread (shard) owns its own timer store and fires its own timers.
+ *
+ * @details
+ * `Scheduler` funnels every task through one event loop, which becomes the bottleneck once tasks are tiny and
+ * plentiful. A reactor has no central loop at all:
+ *
+ * - **Local Adds**: `Add` called from a shard's own task inserts straight into that shard's timer heap, without
+ *   any atomic read-modify-write, and the timer later fires on the same thread, keeping its data core-local.
+ * - **Cross-Shard Adds**: `AddOn` from one shard to another travels over a dedicated single-producer single-consumer
+ *   `SPMCCircularBuffer` per ordered pair of shards. If that ring is full, the timer waits in a local overflow
+ *   queue of the sender instead of blocking it, so two shards can never deadlock on each other.
+ * - **Foreign Adds**: threads that are not shards of this reactor use a per-shard ring guarded by a mutex. If that
+ *   ring is full, the timer spills into a queue behind the same mutex, so a producer never waits for the shard
+ *   while holding the lock the other producers need.
+ *
+ * An idle shard sleeps until its earliest deadline or until another thread rings its doorbell.
+ *
+ * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
+ */
+class Reactor {
+public:
+    using Fn = std::function<void()>;
+
+    /**
+     * @brief Constructs a reactor.
+     * @param shards_count The number of shards, i.e. worker threads, each with its own timer store.
+     * @param ring_size The capacity of each ring carrying timers between two shards.
+     */
+    Reactor(size_t shards_count, size_t ring_size)
+	: shards_count_{std::max<size_t>(shards_count, 1)}
+    {
+	for (size_t i = 0; i < shards_count_; ++i) {
+	    shards_.push_back(std::make_unique<Shard>(shards_count_, ring_size));
+	}
+    }
+
+    /**
+     * @brief Shuts the reactor down, waiting for all pending timers to fire.
+     */
+    ~Reactor() {
+	Shutdown();
+    }
+
+    Reactor(const Reactor&) = delete;
+    Reactor(const Reactor&&) = delete;
+    Reactor& operator=(const Reactor&)= delete;
+    Reactor& operator=(Reactor&&) = delete;
+
+    /**
+     * @brief Adds a timer. From a shard's task it lands in that shard's own store, otherwise shards are picked round-robin.
+     * @param callable The function to be executed.
+     * @param timestamp The time at which the task should be executed.
+     */
+    void Add(Fn callable, std::time_t timestamp) {
+	if (auto shard = CurrentShard()) {
+	    AddOn(*shard, std::move(callable), timestamp);
+	} else {
+	    AddOn(next_shard_.fetch_add(1, std::memory_order_relaxed) % shards_count_, std::move(callable), timestamp);
+	}
+    }
+
+    /**
+     * @brief Adds a timer that fires on a specific shard.
+     * @param shard The index of the shard, less than `Size()`.
+     * @param callable The function to be executed.
+     * @param timestamp The time at which the task should be executed.
+     */
+    void AddOn(size_t shard, Fn callable, std::time_t timestamp) {
+	auto& target = *shards_[shard];
+	auto current = CurrentShard();
+
+	if (current == shard) {
+	    Bump(target.created);
+	    target.PushLocal(Timer { .timestamp = timestamp, .func = std::move(callable) });
+	    return;
+	}
+
+	if (current) {
+	    auto& self = *shards_[*current];
+	    Bump(self.created);
+	    auto& overflow = self.overflow[shard];
+	    if (!overflow.empty() || !Send(*current, shard, callable, timestamp)) {
+		overflow.push_back(Timer { .timestamp = timestamp, .func = std::move(callable) });
+	    }
+	    return;
+	}
+
+	{
+	    std::lock_guard lock(target.foreign_mutex);
+	    Bump(target.foreign_created);
+	    if (target.foreign_spilled.load(std::memory_order_relaxed) || target.foreign.Full()) {
+		target.foreign_spill.push_back(Timer { .timestamp = timestamp, .func = std::move(callable) });
+		target.foreign_spilled.store(true, std::memory_order_release);
+	    } else {
+		auto& slot = target.foreign.Claim();
+		slot.timestamp = timestamp;
+		slot.func = std::move(callable);
+		target.foreign.Commit();
+	    }
+	}
+	target.Ring();
+    }
+
+    /**
+     * @brief Starts one thread per shard.
+     */
+    void Run() {
+	stop_ = false;
+	for (size_t i = 0; i < shards_count_; ++i) {
+	    threads_.emplace_back(&Reactor::ShardLoop, this, i);
+	}
+    }
+
+    /**
+     * @brief Waits until every timer has fired and no task is running anymore, then joins the shards.
+     *
+     * The reactor can be restarted with `Run` afterwards.
+     */
+    void Shutdown() {
+	if (threads_.empty()) {
+	    return;
+	}
+
+	// Quiescence can only be reached when some shard fires a timer, and every shard signals each batch it fires.
+	for (;;) {
+	    auto fired = fired_.load();
+	    if (Quiescent()) {
+		break;
+	    }
+	    fired_wait_.Wait(fired_, fired);
+	}
+
+	stop_ = true;
+	for (auto& shard: shards_) {
+	    shard->Ring();
+	}
+	for (auto& thread: threads_) {
+	    thread.join();
+	}
+	threads_.clear();
+    }
+
+    /**
+     * @brief Returns the number of shards.
+     */
+    size_t Size() const noexcept {
+	return shards_count_;
+    }
+
+    /**
+     * @brief Returns the index of the calling shard, or std::nullopt if the caller is not a shard of this reactor.
+     */
+    std::optional<size_t> CurrentShard() const noexcept {
+	if (current_reactor_ != this) {
+	    return std::nullopt;
+	}
+	return current_shard_;
+    }
+
+private:
+    /**
+     * @struct Timer
+     * @brief A pending task together with the time it is due.
+     */
+    struct Timer {
+	std::time_t timestamp = 0;
+	Fn func;
+    };
+
+    /**
+     * @brief Orders the timer heap so that the earliest deadline is on top.
+     */
+    static bool Later(const Timer& lhs, const Timer& rhs) noexcept {
+	return lhs.timestamp > rhs.timestamp;
+    }
+
+    /**
+     * @struct Shard
+     * @brief Everything a single shard owns. Only `inbound`, `foreign` and the doorbell are touched by other threads.
+     */
+    struct Shard {
+	Shard(size_t shards_count, size_t ring_size)
+	    : overflow(shards_count),
+	      foreign{ring_size}
+	{
+	    for (size_t i = 0; i < shards_count; ++i) {
+		inbound.push_back(std::make_unique<SPMCCircularBuffer<Timer>>(ring_size));
+	    }
+	}
+
+	void PushLocal(Timer timer) {
+	    heap.push_back(std::move(timer));
+	    std::push_heap(heap.begin(), heap.end(), Later);
+	}
+
+	void Ring() noexcept {
+	    doorbell.fetch_add(1);
+	    doorbell_wait.NotifyOne(doorbell);
+	}
+
+	std::vector<Timer> heap;
+	std::vector<std::deque<Timer>> overflow; ///< Timers for other shards whose ring was full, indexed by destination.
+	std::vector<std::unique_ptr<SPMCCircularBuffer<Timer>>> inbound; ///< Rings from other shards, indexed by sender.
+	SPMCCircularBuffer<Timer> foreign;
+	std::mutex foreign_mutex;
+	std::deque<Timer> foreign_spill; ///< Foreign timers that found `foreign` full, guarded by `foreign_mutex`.
+	std::atomic<bool> foreign_spilled = false; ///< Set while `foreign_spill` is not empty, written under `foreign_mutex`.
+	std::atomic<uint32_t> doorbell = 0;
+	FutexWait doorbell_wait;
+	std::atomic<size_t> created = 0; ///< Timers added by this shard's thread, written by it only.
+	std::atomic<size_t> foreign_created = 0; ///< Timers added to this shard by foreign threads, written under `foreign_mutex`.
+	std::atomic<size_t> executed = 0; ///< Timers fired by this shard, written by it only.
+    };
+
+    /**
+     * @brief Increments a counter that has a single writer, without a locked read-modify-write instruction.
+     */
+    static void Bump(std::atomic<size_t>& counter) noexcept {
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Tries to pass a timer over the ring from one shard to another; fails if the ring is full.
+     */
+    bool Send(size_t from, size_t to, Fn& callable, std::time_t timestamp) {
+	auto& ring = *shards_[to]->inbound[from];
+	if (ring.Full()) {
+	    return false;
+	}
+
+	auto& slot = ring.Claim();
+	slot.timestamp = timestamp;
+	slot.func = std::move(callable);
+	ring.Commit();
+	shards_[to]->Ring();
+	return true;
+    }
+
+    /**
+     * @brief The loop of a shard: ingests timers sent to it, fires the expired ones and sleeps until the next deadline.
+     */
+    void ShardLoop(size_t index) {
+	current_reactor_ = this;
+	current_shard_ = index;
+	auto& shard = *shards_[index];
+
+	while (!stop_) {
+	    auto bell = shard.doorbell.load();
+
+	    for (auto& ring: shard.inbound) {
+		while (!ring->Empty()) {
+		    shard.PushLocal(std::move(ring->Peek()));
+		    ring->Release();
+		}
+	    }
+	    while (!shard.foreign.Empty()) {
+		shard.PushLocal(std::move(shard.foreign.Peek()));
+		shard.foreign.Release();
+	    }
+	    if (shard.foreign_spilled.load(std::memory_order_acquire)) {
+		std::lock_guard lock(shard.foreign_mutex);
+		for (auto& timer: shard.foreign_spill) {
+		    shard.PushLocal(std::move(timer));
+		}
+		shard.foreign_spill.clear();
+		shard.foreign_spilled.store(false, std::memory_order_relaxed);
+	    }
+
+	    using namespace std::chrono;
+	    auto timestamp_now = system_clock::to_time_t(system_clock::now());
+	    bool fired = false;
+	    while (!shard.heap.empty() && shard.heap.front().timestamp <= timestamp_now) {
+		std::pop_heap(shard.heap.begin(), shard.heap.end(), Later);
+		auto timer = std::move(shard.heap.back());
+		shard.heap.pop_back();
+
+		std::invoke(timer.func);
+		Bump(shard.executed);
+		fired = true;
+	    }
+	    if (fired) {
+		fired_.fetch_add(1);
+		fired_wait_.NotifyAll(fired_);
+	    }
+
+	    bool backlog = false;
+	    for (size_t to = 0; to < shards_count_; ++to) {
+		auto& overflow = shard.overflow[to];
+		while (!overflow.empty() && Send(index, to, overflow.front().func, overflow.front().timestamp)) {
+		    overflow.pop_front();
+		}
+		backlog = backlog || !overflow.empty();
+	    }
+
+	    // Every timer reaching the shard from elsewhere rings the doorbell, so with nothing local there is no deadline.
+	    if (backlog) {
+		shard.doorbell_wait.WaitUntil(shard.doorbell, bell, system_clock::now() + kBacklogRetry);
+	    } else if (!shard.heap.empty()) {
+		shard.doorbell_wait.WaitUntil(shard.doorbell, bell, system_clock::from_time_t(shard.heap.front().timestamp));
+	    } else {
+		shard.doorbell_wait.Wait(shard.doorbell, bell);
+	    }
+	}
+
+	current_reactor_ = nullptr;
+    }
+
+    /**
+     * @brief Checks whether every timer ever added has fired.
+     *
+     * Executed counters are read before created ones: both only grow and a timer is always created before it is
+     * executed, so equal sums mean that at the moment of the second read nothing was pending or running,
+     * and a running task is the only thing that could have added a new timer.
+     */
+    bool Quiescent() const noexcept {
+	size_t executed = 0;
+	for (auto& shard: shards_) {
+	    executed += shard->executed.load(std::memory_order_acquire);
+	}
+
+	size_t created = 0;
+	for (auto& shard: shards_) {
+	    created += shard->created.load(std::memory_order_acquire) + shard->foreign_created.load(std::memory_order_acquire);
+	}
+
+	return created == executed;
+    }
+
+    static constexpr std::chrono::milliseconds kBacklogRetry{1};
+
+    static inline thread_local const Reactor* current_reactor_ = nullptr;
+    static inline thread_local size_t current_shard_ = 0;
+
+    size_t shards_count_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_shard_ = 0;
+    std::atomic<bool> stop_ = false;
+    std::atomic<uint32_t> fired_ = 0; ///< Bumped by a shard after each batch of fired timers, awaited by `Shutdown`.
+    FutexWait fired_wait_;
+};
+
+} // namespace scheduler
@@ -0,0 +1,374 @@
+/**
+ * @file record_buffer.h
+ * @brief Header file for the SPMCRecordBuffer class.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "wait_strategy.h"
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Thread-safe Single Producer Multiple Consumer (SPMC) ring of variable-length callable records.
+ *
+ * @details
+ * Unlike `SPMCCircularBuffer<std::function<void()>>`, which stores fixed-size slots and lets `std::function`
+ * allocate large captures on the heap, this buffer is byte-oriented: every pushed callable is stored together
+ * with its captures contiguously inside the ring, prefixed by a small header holding its size and type-erased
+ * invoke/destroy entry points (in the spirit of the LMAX Disruptor).
+ *
+ * - **In-Place Execution**: Consumers invoke and destroy each record directly in the ring, nothing is moved out.
+ * - **Out-Of-Order Completion**: Consumers claim records in order but may finish them in any order; the space
+ *   is handed back to the producer only once every record before it has completed.
+ * - **Wrap-Around**: A record never straddles the end of the ring. If it does not fit into the tail, the tail
+ *   is filled with a padding record that consumers silently skip.
+ * - **Oversized Callables**: A callable larger than the whole ring is boxed on the heap, so `Push` never fails.
+ *
+ * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
+ *
+ * @tparam Wait The wait strategy used whenever a thread has to block, see `SPMCCircularBuffer`.
+ */
+template<typename Wait = FutexWait>
+class SPMCRecordBuffer {
+    /**
+     * @struct Header
+     * @brief Prefix of every record in the ring. Its size is also the allocation granularity of the ring.
+     */
+    struct alignas(std::max_align_t) Header {
+	size_t size;
+	void (*invoke)(void*);
+	void (*destroy)(void*);
+	std::atomic<bool> consumed;
+    };
+
+    /**
+     * @struct Cell
+     * @brief Raw, suitably aligned storage unit of the ring. Headers and payloads are constructed on top of cells.
+     */
+    struct alignas(Header) Cell {
+	std::byte bytes[sizeof(Header)];
+    };
+
+    static constexpr size_t kGranularity = sizeof(Cell);
+
+public:
+    /**
+     * @brief Constructs a record buffer with a specified capacity.
+     *
+     * @param size The capacity of the ring in bytes. It is rounded up to a multiple of the record header size.
+     */
+    SPMCRecordBuffer(size_t size)
+	: capacity_(RoundUp(size == 0 ? 1 : size)),
+	  buf_(std::make_unique<Cell[]>(capacity_ / kGranularity))
+    { }
+
+    /**
+     * @brief Destroys every record that has not been consumed, without invoking it.
+     */
+    ~SPMCRecordBuffer() {
+	for (size_t pos = claim_pos_; pos < write_pos_; pos += At(pos)->size) {
+	    if (At(pos)->destroy) {
+		At(pos)->destroy(Payload(pos));
+	    }
+	}
+    }
+
+    SPMCRecordBuffer(const SPMCRecordBuffer&) = delete;
+    SPMCRecordBuffer(SPMCRecordBuffer&&) = delete;
+    SPMCRecordBuffer& operator=(const SPMCRecordBuffer& other) = delete;
+    SPMCRecordBuffer& operator=(SPMCRecordBuffer&& other) = delete;
+
+    /**
+     * @brief Constructs a callable record in place at the current write position.
+     *
+     * @tparam F The type of the callable. It must be invocable without arguments.
+     * @param callable The callable to store; it is moved or copied into the ring together with its captures.
+     *
+     * @details
+     * If there is not enough free space, the method waits until consumers complete enough records.
+     *
+     * @warning Only the single producer thread may call this method.
+     */
+    template<typename F>
+    void Push(F&& callable) {
+	using D = std::decay_t<F>;
+
+	if (RecordSize<D>() > capacity_) {
+	    PushRecord([boxed = std::make_unique<D>(std::forward<F>(callable))]() { std::invoke(*boxed); });
+	} else {
+	    PushRecord(std::forward<F>(callable));
+	}
+    }
+
+    /**
+     * @brief Attempts to claim one record within a specified time limit, then invokes and destroys it in place.
+     *
+     * @param limit_ms The maximum duration to wait for a record to become available.
+     * @return True if a record was executed, false otherwise.
+     *
+     * @details
+     * Both acquiring the read lock and waiting for a record count against the same deadline; an idle consumer
+     * sleeps according to the `Wait` strategy until the next `Push`. The read lock is held only while claiming
+     * the record; the record itself is executed outside the lock, so several consumers run their records concurrently.
+     */
+    bool TryConsumeFor(std::chrono::milliseconds limit_ms) {
+	auto deadline = std::chrono::steady_clock::now() + limit_ms;
+	std::unique_lock lock(mutex_read_, std::defer_lock);
+
+	if (!lock.try_lock_until(deadline)) {
+	    return false;
+	}
+
+	for (;;) {
+	    SkipPadding();
+
+	    auto old_write = write_pos_.load();
+	    if (claim_pos_ < old_write) {
+		break;
+	    }
+
+	    if (!write_wait_.WaitUntil(write_pos_, old_write, deadline)) {
+		return false;
+	    }
+	}
+
+	auto pos = claim_pos_.load();
+	claim_pos_ += At(pos)->size;
+	claim_count_.fetch_add(1);
+	lock.unlock();
+
+	Execute(pos);
+	return true;
+    }
+
+    /**
+     * @brief Claims one record if one is available, then invokes and destroys it in place.
+     *
+     * @return True if a record was executed, false if the buffer was empty.
+     *
+     * @details
+     * Never waits for data, only for the read lock, which is held just long enough to claim a record.
+     * Meant for consumers that implement their own parking on top of the buffer.
+     */
+    bool TryConsume() {
+	std::unique_lock lock(mutex_read_);
+	SkipPadding();
+
+	if (claim_pos_ >= write_pos_) {
+	    return false;
+	}
+
+	auto pos = claim_pos_.load();
+	claim_pos_ += At(pos)->size;
+	claim_count_.fetch_add(1);
+	lock.unlock();
+
+	Execute(pos);
+	return true;
+    }
+
+    /**
+     * @brief Claims up to `max_records` records under a single acquisition of the read lock, then runs them in order.
+     *
+     * @param max_records The maximum number of records to claim at once.
+     * @return The number of records executed, zero if the buffer was empty.
+     *
+     * @details
+     * Amortizes the read lock over a whole batch when records are tiny. The claimed records form one contiguous
+     * range of the ring that belongs to the caller until each of them has been executed, so no bookkeeping beyond
+     * the range bounds is needed. Like `TryConsume`, it never waits for data.
+     */
+    size_t TryConsumeBatch(size_t max_records) {
+	std::unique_lock lock(mutex_read_);
+	auto begin = claim_pos_.load();
+	size_t claimed = 0;
+
+	while (claimed < max_records && claim_pos_ < write_pos_) {
+	    if (At(claim_pos_)->invoke) {
+		++claimed;
+	    }
+	    claim_pos_ += At(claim_pos_)->size;
+	}
+	claim_count_ += claimed;
+	auto end = claim_pos_.load();
+	lock.unlock();
+
+	for (auto pos = begin; pos < end;) {
+	    auto* header = At(pos);
+	    auto size = header->size;
+	    if (header->invoke) {
+		header->invoke(Payload(pos));
+	    }
+	    header->consumed = true;
+	    pos += size;
+	}
+
+	if (begin != end) {
+	    AdvanceRelease();
+	}
+
+	return claimed;
+    }
+
+    /**
+     * @brief Returns the number of records that have been pushed but not claimed yet.
+     *
+     * @details
+     * The value is a snapshot and may be stale by the time the caller looks at it; it is meant for heuristics.
+     */
+    size_t Size() const noexcept {
+	auto claimed = claim_count_.load();
+	return write_count_ - claimed;
+    }
+
+    /**
+     * @brief Checks if there are no records left to claim.
+     *
+     * @return True if the buffer is empty, false otherwise.
+     */
+    bool Empty() const noexcept {
+	return claim_pos_ == write_pos_;
+    }
+
+private:
+    static constexpr size_t RoundUp(size_t size) noexcept {
+	return (size + kGranularity - 1) / kGranularity * kGranularity;
+    }
+
+    template<typename D>
+    static constexpr size_t RecordSize() noexcept {
+	return kGranularity + RoundUp(sizeof(D));
+    }
+
+    Header* At(size_t pos) const noexcept {
+	return std::launder(reinterpret_cast<Header*>(&buf_[pos % capacity_ / kGranularity]));
+    }
+
+    void* Payload(size_t pos) const noexcept {
+	return &buf_[pos % capacity_ / kGranularity + 1];
+    }
+
+    template<typename F>
+    void PushRecord(F&& callable) {
+	using D = std::decay_t<F>;
+	static_assert(alignof(D) <= alignof(Header), "over-aligned callables are not supported");
+
+	size_t size = RecordSize<D>();
+	size_t tail = capacity_ - write_pos_ % capacity_;
+
+	// The padding is published on its own: waiting for room for padding and record at once could wait forever,
+	// as the two together may exceed the capacity.
+	if (size > tail) {
+	    WaitForRoom(tail);
+	    ::new (static_cast<void*>(&buf_[write_pos_ % capacity_ / kGranularity])) Header{tail, nullptr, nullptr, false};
+	    write_pos_.fetch_add(tail);
+	    write_wait_.NotifyOne(write_pos_);
+	}
+	WaitForRoom(size);
+
+	size_t pos = write_pos_;
+	::new (Payload(pos)) D(std::forward<F>(callable));
+	::new (static_cast<void*>(&buf_[pos % capacity_ / kGranularity])) Header{
+	    size,
+	    [](void* payload) {
+		auto* fn = std::launder(static_cast<D*>(payload));
+		struct Guard {
+		    D* fn;
+		    ~Guard() { fn->~D(); }
+		} guard{fn};
+		std::invoke(*fn);
+	    },
+	    [](void* payload) {
+		std::launder(static_cast<D*>(payload))->~D();
+	    },
+	    false,
+	};
+
+	write_count_.fetch_add(1);
+	write_pos_.fetch_add(size);
+	write_wait_.NotifyOne(write_pos_);
+    }
+
+    /**
+     * @brief Waits until `size` bytes past the write position have been released by the consumers.
+     */
+    void WaitForRoom(size_t size) noexcept {
+	auto old_release = release_pos_.load();
+	while (write_pos_ + size - old_release > capacity_) {
+	    release_wait_.Wait(release_pos_, old_release);
+	    old_release = release_pos_.load();
+	}
+    }
+
+    /**
+     * @brief Claims and completes padding records at the claim position. Must be called under the read lock.
+     */
+    void SkipPadding() noexcept {
+	while (claim_pos_ < write_pos_ && !At(claim_pos_)->invoke) {
+	    auto padding = claim_pos_.load();
+	    claim_pos_ += At(padding)->size;
+	    Complete(padding);
+	}
+    }
+
+    /**
+     * @brief Invokes and destroys a claimed record, then completes it.
+     */
+    void Execute(size_t pos) {
+	At(pos)->invoke(Payload(pos));
+	Complete(pos);
+    }
+
+    /**
+     * @brief Marks a claimed record as consumed and returns every leading consumed record to the producer.
+     */
+    void Complete(size_t pos) noexcept {
+	At(pos)->consumed = true;
+	AdvanceRelease();
+    }
+
+    /**
+     * @brief Moves the release position past every leading consumed record and wakes up the producer.
+     */
+    void AdvanceRelease() noexcept {
+	std::lock_guard lock(mutex_release_);
+
+	auto release = release_pos_.load();
+	while (release < claim_pos_ && At(release)->consumed) {
+	    release += At(release)->size;
+	}
+
+	if (release != release_pos_) {
+	    release_pos_ = release;
+	    release_wait_.NotifyOne(release_pos_);
+	}
+    }
+
+    size_t capacity_;
+    std::unique_ptr<Cell[]> buf_;
+    std::atomic<size_t> write_pos_ = 0;
+    std::atomic<size_t> claim_pos_ = 0;
+    std::atomic<size_t> release_pos_ = 0;
+    std::atomic<size_t> write_count_ = 0;
+    std::atomic<size_t> claim_count_ = 0;
+    WaitLock<Wait> mutex_read_;
+    std::mutex mutex_release_;
+    [[no_unique_address]] Wait release_wait_;
+    [[no_unique_address]] Wait write_wait_;
+};
+
+} // namespace internal
+} // namespace scheduler
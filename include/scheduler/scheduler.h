@@ -5,38 +5,144 @@
 
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <ctime>
-#include <list>
-#include <stack>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
 #include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "blocking_pool.h"
 #include "circular_buffer.h"
+#include "concurrent_skiplist.h"
+#include "executor.h"
+#include "multi_queue.h"
+#include "spill_store.h"
 #include "threadpool.h"
+#include "timer_hook.h"
+#include "timer_service.h"
+#include "timer_store.h"
+#include "timerfd_loop.h"
+#include "wait_strategy.h"
 
 namespace scheduler {
 using namespace internal;
 
+/**
+ * @enum TaskKind
+ * @brief Selects the executor a task is dispatched to once it expires.
+ */
+enum class TaskKind {
+    Normal, ///< Short, latency-critical callback, executed by the fixed-size thread pool.
+    Blocking, ///< Callback that may block for a long time, executed by the elastic blocking pool.
+};
+
+/**
+ * @enum WakeMode
+ * @brief Selects how a scheduler's event loop waits for the next deadline.
+ */
+enum class WakeMode {
+    BusyPoll, ///< Polls continuously. Lowest latency, but the event loop occupies a whole core.
+    Precise, ///< Sleeps until shortly before the next deadline, then spins onto it, see `HybridWait`.
+    TimerFd, ///< Blocks in `epoll_wait` on a timerfd armed for the next deadline, see `TimerFdLoop`. Linux only.
+    External, ///< Like `TimerFd`, but without a thread: the application waits on `Fd()` and calls `ProcessEvents`.
+};
+
+/**
+ * @typedef ExecutorId
+ * @brief Identifies an executor registered with `Scheduler::AddExecutor`.
+ */
+using ExecutorId = size_t;
+
+/**
+ * @brief The executor created together with every scheduler, named "default".
+ */
+inline constexpr ExecutorId kDefaultExecutor = 0;
+
+/**
+ * @typedef SpillHandlerId
+ * @brief Identifies a handler registered with `Scheduler::RegisterSpillHandler`.
+ */
+using SpillHandlerId = uint32_t;
+
 /**
  * @class Scheduler
  * @brief A task scheduler that manages and executes tasks at specified times using a thread pool.
  *
+ * By default every scheduler runs its own event-loop thread. A scheduler constructed with a `TimerService`
+ * is only a lightweight facade instead: its event loop is driven by the service's shared thread.
+ *
  * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
  */
-class Scheduler {
+class Scheduler : private TimerClient {
 
 public:
     /**
      * @brief Constructs a Scheduler with a specified buffer size and number of threads.
      * @param buffer_size The size of the circular buffer for storing tasks.
      * @param threads_count The number of threads in the thread pool.
+     * @param blocking_threads_count The maximum number of threads the pool for `TaskKind::Blocking` tasks may grow to.
      */
-    Scheduler(size_t buffer_size, size_t threads_count)
-	: tasks_buffer_{buffer_size}, pool_{threads_count, buffer_size}
-    {}
+    Scheduler(size_t buffer_size, size_t threads_count, size_t blocking_threads_count = kDefaultBlockingThreads)
+	: tasks_buffer_{buffer_size}, blocking_pool_{blocking_threads_count}
+    {
+	AddExecutor("default", threads_count, buffer_size);
+    }
+
+    /**
+     * @brief Constructs a Scheduler that dispatches into an existing executor instead of creating its own thread pool.
+     *
+     * Lets many schedulers share one pool, or run their tasks on an application-provided executor.
+     * @param buffer_size The size of the circular buffer for storing tasks.
+     * @param executor The executor registered as "default". The scheduler never starts or shuts it down.
+     * @param blocking_threads_count The maximum number of threads the pool for `TaskKind::Blocking` tasks may grow to.
+     */
+    Scheduler(size_t buffer_size, std::shared_ptr<Executor> executor, size_t blocking_threads_count = kDefaultBlockingThreads)
+	: tasks_buffer_{buffer_size}, blocking_pool_{blocking_threads_count}
+    {
+	AddExecutor("default", std::move(executor));
+    }
+
+    /**
+     * @brief Constructs a Scheduler whose event loop is driven by a shared timer service instead of a thread of its own.
+     * @param buffer_size The size of the circular buffer for storing tasks.
+     * @param threads_count The number of threads in the thread pool.
+     * @param service The service to register into on `Run`, usually `TimerService::Global()`. Must outlive the scheduler.
+     */
+    Scheduler(size_t buffer_size, size_t threads_count, TimerService& service)
+	: Scheduler(buffer_size, threads_count)
+    {
+	service_ = &service;
+	wake_mode_ = WakeMode::Precise;
+    }
+
+    /**
+     * @brief Constructs a Scheduler that neither owns an event-loop thread nor a thread pool.
+     *
+     * Combined with a shared executor, any number of such schedulers costs a constant number of threads.
+     * @param buffer_size The size of the circular buffer for storing tasks.
+     * @param executor The executor registered as "default". The scheduler never starts or shuts it down.
+     * @param service The service to register into on `Run`, usually `TimerService::Global()`. Must outlive the scheduler.
+     */
+    Scheduler(size_t buffer_size, std::shared_ptr<Executor> executor, TimerService& service)
+	: Scheduler(buffer_size, std::move(executor))
+    {
+	service_ = &service;
+	wake_mode_ = WakeMode::Precise;
+    }
 
     /**
      * @brief Shuts down the scheduler, stopping the event loop and thread pool.
@@ -56,14 +162,374 @@ public:
 
     /**
      * @brief Adds a task to the scheduler with a specified execution time.
+     *
+     * Called from a task running on one of the scheduler's own pools, a follow-up due within `kLocalHorizon`
+     * bypasses the event loop and stays on the calling worker, see `ThreadPool::AddLocal`. Safe to call from any
+     * thread, including from tasks running concurrently on several workers.
+     * @param callable The function to be executed.
+     * @param timestamp The time at which the task should be executed.
+     * @param kind Whether the task is a short callback or may block; blocking tasks are offloaded to a separate pool
+     *             so they never hold up other expired tasks.
+     *
+     * @note The task waits for its deadline as a `std::function`, so a callable whose captures exceed its small
+     *       buffer is allocated once here. Only the hand-off from the event loop to the pool is allocation-free.
+     */
+    void Add(std::function<void()> callable, std::time_t timestamp, TaskKind kind = TaskKind::Normal) {
+	if (kind == TaskKind::Normal && TryAddLocal(callable, timestamp, kDefaultExecutor)) {
+	    return;
+	}
+
+	Enqueue(callable, timestamp, kind, kDefaultExecutor);
+    }
+
+    /**
+     * @brief Adds a task to the scheduler, to be executed by a specific executor.
      * @param callable The function to be executed.
      * @param timestamp The time at which the task should be executed.
+     * @param executor The executor that runs the task, as returned by `AddExecutor` or `FindExecutor`.
+     * @throws std::out_of_range If no executor is registered under `executor`; the task is not added then.
+     */
+    void Add(std::function<void()> callable, std::time_t timestamp, ExecutorId executor) {
+	if (TryAddLocal(callable, timestamp, executor)) {
+	    return;
+	}
+
+	Enqueue(callable, timestamp, TaskKind::Normal, executor);
+    }
+
+    /**
+     * @brief Enables the disk tier for tasks added with `AddSerialized`.
+     *
+     * Serialized tasks due within `horizon` are kept in memory like any other task; later ones are spilled to
+     * sorted, memory-mapped run files in `directory` and streamed back as their deadline enters the horizon,
+     * so memory use no longer grows with the number of far-future tasks. See `SpillStore`.
+     *
+     * @param directory The directory run files are created in, preferably on a local disk.
+     * @param horizon How far ahead, in seconds, tasks are kept in memory.
+     *
+     * @warning Must not be called while the scheduler is running.
+     */
+    void EnableSpill(std::string directory, std::time_t horizon = kDefaultSpillHorizon) {
+	spill_ = std::make_unique<SpillStore>(std::move(directory));
+	spill_horizon_ = horizon;
+    }
+
+    /**
+     * @brief Returns why the disk tier last failed to write a run, or no error if the last write succeeded.
+     *
+     * While writing fails, spilled tasks stay in memory and writes are retried ever less often, see `SpillStore`.
+     */
+    std::error_code SpillError() const {
+	return spill_ ? spill_->Error() : std::error_code();
+    }
+
+    /**
+     * @brief Registers the function that executes serialized tasks of one kind.
+     * @param handler Called with the payload passed to `AddSerialized`.
+     * @return The identifier to pass to `AddSerialized`.
+     *
+     * @warning Must not be called while the scheduler is running.
+     */
+    SpillHandlerId RegisterSpillHandler(std::function<void(std::string_view)> handler) {
+	spill_handlers_.push_back(std::make_shared<const SpillHandler>(std::move(handler)));
+	return static_cast<SpillHandlerId>(spill_handlers_.size() - 1);
+    }
+
+    /**
+     * @brief Adds a serializable task, which may be spilled to disk until it is due, see `EnableSpill`.
+     * @param handler The handler executing the task, as returned by `RegisterSpillHandler`.
+     * @param payload The serialized task, passed to the handler.
+     * @param timestamp The time at which the task should be executed.
+     * @throws std::out_of_range If no handler is registered under `handler`; the task is not added then.
+     */
+    void AddSerialized(SpillHandlerId handler, std::string payload, std::time_t timestamp) {
+	// Checked here, as a spilled task is only turned back into a callable on the event loop, possibly days later.
+	if (handler >= spill_handlers_.size()) {
+	    throw std::out_of_range("unknown spill handler");
+	}
+
+	using namespace std::chrono;
+	if (spill_ && timestamp >= system_clock::to_time_t(system_clock::now()) + spill_horizon_) {
+	    spill_->Add(timestamp, handler, std::move(payload));
+	    // The task is refilled at the first second at which it falls within the horizon.
+	    WakeBy(system_clock::from_time_t(timestamp - spill_horizon_ + 1));
+	    return;
+	}
+
+	Add(Deserialize(handler, payload), timestamp);
+    }
+
+    /**
+     * @brief Arms an intrusive timer, or moves the deadline of an already armed one.
+     *
+     * The hook is linked into the timer store as is, without any allocation. Once the deadline expires,
+     * its callback runs on the default executor. Safe to call from any thread, including from tasks.
+     * @param hook The hook to arm. Must stay alive until it fires or is disarmed.
+     * @param deadline The time at which the hook's callback should be invoked.
+     */
+    void Arm(TimerHook& hook, std::time_t deadline) {
+	{
+	    std::lock_guard lock(hooks_->mutex);
+	    hooks_->list.Link(hook, deadline);
+	}
+	WakeBy(std::chrono::system_clock::from_time_t(deadline));
+    }
+
+    /**
+     * @brief Disarms an intrusive timer.
+     *
+     * An expired hook whose callback is queued but has not started yet is disarmed as well: the callback is not
+     * invoked, and the hook may be destroyed once this method returns.
+     * @param hook The hook to disarm.
+     * @return True if the hook was armed or its callback was cancelled, false if it was not armed or its callback
+     *         has already started.
+     */
+    bool Disarm(TimerHook& hook) {
+	std::lock_guard lock(hooks_->mutex);
+	return hooks_->list.Unlink(hook);
+    }
+
+    /**
+     * @brief Selects the data structure holding pending tasks, moving the tasks pending so far over.
+     *
+     * @param backend The backend to use from now on. `TimerBackend::Adaptive`, the default, lets the scheduler
+     *                pick one and switch online as the workload changes, see `TimerStore`.
+     *
+     * @warning Must not be called while the scheduler is running.
+     */
+    void SetTimerBackend(TimerBackend backend) {
+	// Tasks linked into the concurrent stores are moved out first, as they are only polled while selected.
+	std::vector<Task> moved;
+	auto collect = [&moved](Task&& task) { moved.push_back(std::move(task)); };
+	skiplist_.PopExpired(std::numeric_limits<int64_t>::max(), collect);
+	while (multi_queue_ && !multi_queue_->Empty()) {
+	    multi_queue_->PopExpired(std::numeric_limits<int64_t>::max(), collect);
+	}
+
+	backend_ = backend;
+	multi_queue_.reset();
+	if (backend == TimerBackend::MultiQueue) {
+	    multi_queue_ = std::make_unique<MultiQueue<Task>>(dispatchers_count_ * relaxation_);
+	} else if (backend != TimerBackend::SkipList) {
+	    tasks_.SetBackend(backend);
+	}
+
+	for (auto& task: moved) {
+	    if (multi_queue_) {
+		multi_queue_->Insert(task.timestamp, std::move(task));
+	    } else if (backend == TimerBackend::SkipList) {
+		skiplist_.Insert(task.timestamp, std::move(task));
+	    } else {
+		tasks_.Push(task.timestamp, std::move(task));
+	    }
+	}
+    }
+
+    /**
+     * @brief Configures the threads popping expired tasks when the `TimerBackend::MultiQueue` backend is selected.
+     *
+     * @param dispatchers_count The number of dispatcher threads, the event loop included.
+     * @param relaxation The number of heaps per dispatcher. A pop returns one of roughly the
+     *                   `dispatchers_count * relaxation` earliest tasks rather than the earliest one.
+     *
+     * @warning Must not be called while the scheduler is running.
+     */
+    void SetDispatchers(size_t dispatchers_count, size_t relaxation = kDefaultRelaxation) {
+	dispatchers_count_ = std::max<size_t>(dispatchers_count, 1);
+	relaxation_ = std::max<size_t>(relaxation, 1);
+	if (backend_ == TimerBackend::MultiQueue) {
+	    SetTimerBackend(backend_);
+	}
+    }
+
+    /**
+     * @brief Selects how the event loop waits for the next deadline.
+     *
+     * In `WakeMode::Precise`, the loop sleeps on a futex until shortly before the earliest pending deadline
+     * (of a task, a hook, or a spilled task to be read back) and spins for the last few tens of microseconds.
+     * The spin window is calibrated from the measured wake-up overshoot. Adding something due before the loop
+     * planned to wake up wakes it at once.
+     *
+     * In `WakeMode::TimerFd` and `WakeMode::External`, the loop waits on the descriptor returned by `Fd()`:
+     * a timerfd armed for the earliest pending deadline, and an eventfd signalled by `Add` and `Shutdown` in the
+     * same cases. While nothing is pending the timer is disarmed, so an idle scheduler is never woken up.
+     * In `WakeMode::External`, the ring is drained by `ProcessEvents` only, so an `Add` that finds it full stores
+     * the task aside rather than waiting, and the application's loop thread may add tasks as well.
+     *
+     * A scheduler driven by a `TimerService` starts in `WakeMode::Precise`: the service sleeps until the earliest
+     * deadline of all its schedulers. In `WakeMode::BusyPoll`, the service polls continuously while the scheduler
+     * is registered. The descriptor-based modes do not apply to it.
+     *
+     * @return False if the descriptors of `WakeMode::TimerFd` or `WakeMode::External` could not be created,
+     *         e.g. on a platform other than Linux, or if the scheduler is driven by a `TimerService`;
+     *         the wake mode is left unchanged then.
+     *
+     * @warning Must not be called while the scheduler is running.
+     */
+    bool SetWakeMode(WakeMode mode) {
+	if (mode == WakeMode::TimerFd || mode == WakeMode::External) {
+	    if (service_) {
+		return false;
+	    }
+	    if (!timer_fd_) {
+		auto loop = std::make_unique<TimerFdLoop>();
+		if (!loop->Valid()) {
+		    return false;
+		}
+		timer_fd_ = std::move(loop);
+	    }
+	} else {
+	    timer_fd_.reset();
+	}
+	wake_mode_ = mode;
+	return true;
+    }
+
+    /**
+     * @brief Returns the descriptor to wait on in `WakeMode::External`, or -1 in the other modes.
+     *
+     * The descriptor becomes readable (`EPOLLIN`) whenever the scheduler has work to do; register it in the
+     * application's epoll loop and call `ProcessEvents` each time it fires. It stays the same until the wake
+     * mode is changed.
+     */
+    int Fd() const noexcept {
+	return timer_fd_ ? timer_fd_->Fd() : -1;
+    }
+
+    /**
+     * @brief Runs one iteration of the event loop in `WakeMode::External`: dispatches the expired tasks and
+     *        re-arms the timer for the next deadline.
+     *
+     * Call it whenever `Fd()` is readable. Calling it at other times is harmless, and so is calling it in another
+     * wake mode, where it returns right away.
+     *
+     * @warning Must only be called from one thread at a time, and not concurrently with `Shutdown`.
+     */
+    void ProcessEvents() {
+	if (wake_mode_ != WakeMode::External) {
+	    return;
+	}
+
+	timer_fd_->Drain();
+	Poll();
+
+	if (auto wake = Plan()) {
+	    Arm(*wake);
+	} else {
+	    // Something arrived while polling; the descriptor stays readable, so the application calls in again.
+	    timer_fd_->Notify();
+	}
+    }
+
+    /**
+     * @brief Hands tasks over to their executor ahead of their deadline, to run once the deadline is reached.
+     *
+     * Dispatching a task to a worker takes a queue hop and a wake-up, whose latency varies. With a lead, the event
+     * loop dispatches a task as soon as its deadline is less than `lead` away, together with the deadline as
+     * a not-before time; the worker then waits for the deadline itself, sleeping and spinning like `HybridWait`,
+     * and runs the task right on it. The worker is occupied during the wait, so the lead should not be much
+     * longer than the dispatch latency it hides, typically a few hundred microseconds. Intrusive timers are not
+     * handed over early.
+     *
+     * @param lead How early tasks are handed over; zero, the default, dispatches tasks once they are due.
+     *
+     * @warning Must not be called while the scheduler is running.
+     */
+    void SetEarlyHandoff(std::chrono::microseconds lead) {
+	handoff_lead_ = std::max(lead, std::chrono::microseconds::zero());
+    }
+
+    /**
+     * @brief Returns how long before a deadline the event loop currently stops sleeping in `WakeMode::Precise`.
+     */
+    std::chrono::nanoseconds SpinWindow() const noexcept {
+	return wakeup_wait_.SpinWindow();
+    }
+
+    /**
+     * @brief Returns a snapshot of the state of the pending tasks' store, refreshed about once per second.
+     */
+    TimerMetrics StoreMetrics() const {
+	auto metrics = tasks_.Metrics();
+	if (backend_ == TimerBackend::SkipList || backend_ == TimerBackend::MultiQueue) {
+	    metrics.backend = backend_;
+	    metrics.adaptive = false;
+	}
+	return metrics;
+    }
+
+    /**
+     * @brief Registers a named executor with its own worker threads and queue.
+     *
+     * Tasks routed to different executors share the scheduler's event loop but never share workers, so e.g.
+     * bulk jobs cannot delay latency-sensitive callbacks.
+     *
+     * @param name The name under which the executor can be looked up.
+     * @param threads_count The number of threads of the executor.
+     * @param buffer_size The number of tasks the executor's queue should hold.
+     * @param max_batch The maximum number of tasks a worker claims at once, see `ThreadPool`.
+     * @return The identifier to pass to `Add`.
+     *
+     * @warning Must not be called while the scheduler is running.
      */
-    void Add(std::function<void()> callable, std::time_t timestamp) {
-	tasks_buffer_.EmplacePush(Task {
-	    .timestamp = std::move(timestamp),
-	    .func = std::move(callable),
+    ExecutorId AddExecutor(std::string name, size_t threads_count, size_t buffer_size, size_t max_batch = 1) {
+	auto pool = std::make_shared<ThreadPool>(threads_count, buffer_size, max_batch);
+	executors_.push_back(NamedExecutor {
+	    .name = std::move(name),
+	    .executor = pool,
+	    .owned = pool.get(),
 	});
+	return executors_.size() - 1;
+    }
+
+    /**
+     * @brief Registers an external executor under a name.
+     *
+     * The executor may be shared with other schedulers; this scheduler only dispatches into it and never starts
+     * or shuts it down.
+     *
+     * @param name The name under which the executor can be looked up.
+     * @param executor The executor to dispatch into.
+     * @return The identifier to pass to `Add`.
+     *
+     * @warning Must not be called while the scheduler is running.
+     */
+    ExecutorId AddExecutor(std::string name, std::shared_ptr<Executor> executor) {
+	executors_.push_back(NamedExecutor {
+	    .name = std::move(name),
+	    .executor = std::move(executor),
+	});
+	return executors_.size() - 1;
+    }
+
+    /**
+     * @brief Looks up an executor by name.
+     * @param name The name passed to `AddExecutor`.
+     * @return The executor's identifier, or std::nullopt if there is no executor with that name.
+     */
+    std::optional<ExecutorId> FindExecutor(std::string_view name) const {
+	for (size_t i = 0; i < executors_.size(); ++i) {
+	    if (executors_[i].name == name) {
+		return i;
+	    }
+	}
+	return std::nullopt;
+    }
+
+    /**
+     * @brief Returns a snapshot of the counters of the pool executing tasks of the given kind.
+     * @param kind The kind of tasks whose pool is queried; `TaskKind::Normal` refers to the default executor.
+     */
+    PoolMetrics Metrics(TaskKind kind = TaskKind::Normal) const {
+	return kind == TaskKind::Blocking ? blocking_pool_.Metrics() : Metrics(kDefaultExecutor);
+    }
+
+    /**
+     * @brief Returns a snapshot of the counters of a registered executor.
+     * @param executor The executor to query.
+     */
+    PoolMetrics Metrics(ExecutorId executor) const {
+	return executors_.at(executor).executor->Metrics();
     }
 
     /**
@@ -76,10 +542,35 @@ public:
      */
     void Shutdown() {
 	break_ = true;
+	Wake();
+	if (registered_) {
+	    drained_wait_.Wait(drained_, 0u);
+	    service_->Unregister(this);
+	    registered_ = false;
+	}
 	if (event_loop_thread_.joinable()) {
 	    event_loop_thread_.join();
 	}
-	pool_.Shutdown();
+	if (external_running_) {
+	    // The application's loop may already be gone, so the remaining tasks are waited for right here.
+	    for (ProcessEvents(); !Idle(); ProcessEvents()) {
+		timer_fd_->Wait();
+	    }
+	    external_running_ = false;
+	}
+	// The event loop left nothing behind, so the dispatchers only have to notice the shutdown.
+	dispatch_round_.fetch_add(1);
+	dispatch_wait_.NotifyAll(dispatch_round_);
+	for (auto& dispatcher: dispatchers_) {
+	    dispatcher.join();
+	}
+	dispatchers_.clear();
+	for (auto& executor: executors_) {
+	    if (executor.owned) {
+		executor.owned->Shutdown();
+	    }
+	}
+	blocking_pool_.Shutdown();
     }
 
     /**
@@ -91,8 +582,30 @@ public:
      */
     void Run() {
 	break_ = false;
-	event_loop_thread_ = std::thread(std::bind(&Scheduler::EventLoop, this));
-	pool_.Run();
+	for (auto& executor: executors_) {
+	    if (executor.owned) {
+		executor.owned->Run();
+	    }
+	}
+	blocking_pool_.Run();
+
+	if (service_) {
+	    drained_ = 0;
+	    registered_ = true;
+	    service_->Register(this);
+	} else if (wake_mode_ == WakeMode::External) {
+	    // Makes the descriptor readable, so the application picks up the tasks added before `Run`.
+	    external_running_ = true;
+	    timer_fd_->Notify();
+	} else {
+	    event_loop_thread_ = std::thread(std::bind(&Scheduler::EventLoop, this));
+	}
+
+	if (multi_queue_) {
+	    for (size_t i = 1; i < dispatchers_count_; ++i) {
+		dispatchers_.emplace_back(&Scheduler::DispatchLoop, this);
+	    }
+	}
     }
 
 private:
@@ -103,42 +616,471 @@ private:
     struct Task {
 	std::time_t timestamp;
 	std::function<void()> func;
+	TaskKind kind = TaskKind::Normal;
+	ExecutorId executor = kDefaultExecutor;
+    };
+
+    /**
+     * @struct Hooks
+     * @brief The armed intrusive timers and the mutex guarding them.
+     *
+     * Queued invocations refer to the hooks through a plain pointer, which keeps their closures within the small
+     * buffer of a `std::function`. As they may run on a shared executor after the scheduler is gone, the last of
+     * them deletes the hooks in that case, see `HooksRelease`.
+     */
+    struct Hooks {
+	std::mutex mutex;
+	TimerHookList list;
+	bool orphaned = false; ///< Set once the scheduler is gone while invocations are still queued.
+
+	/**
+	 * @brief Runs a queued invocation: claims its fire slot and invokes the callback unless it was cancelled.
+	 */
+	static void Fire(Hooks* hooks, uint32_t fire) {
+	    TimerHook* hook;
+	    bool last;
+	    {
+		std::lock_guard lock(hooks->mutex);
+		hook = hooks->list.Claim(fire);
+		last = hooks->orphaned && !hooks->list.Queued();
+	    }
+	    if (last) {
+		delete hooks;
+	    }
+	    if (hook) {
+		TimerHookList::Fire(*hook);
+	    }
+	}
+    };
+
+    /**
+     * @struct HooksRelease
+     * @brief Deletes the hooks along with the scheduler, or leaves that to the last invocation still queued.
+     */
+    struct HooksRelease {
+	void operator()(Hooks* hooks) const {
+	    {
+		std::lock_guard lock(hooks->mutex);
+		if (hooks->list.Queued()) {
+		    hooks->orphaned = true;
+		    return;
+		}
+	    }
+	    delete hooks;
+	}
     };
-    
+
+    /**
+     * @struct NamedExecutor
+     * @brief An executor registered with `AddExecutor`.
+     */
+    struct NamedExecutor {
+	std::string name;
+	std::shared_ptr<Executor> executor;
+	ThreadPool* owned = nullptr; ///< Set if the scheduler created the executor and therefore drives its lifecycle.
+    };
+
+    using SpillHandler = std::function<void(std::string_view)>;
+
+    static constexpr size_t kDefaultBlockingThreads = 16;
+    static constexpr size_t kDefaultDispatchers = 2;
+    static constexpr size_t kDefaultRelaxation = 2;
+    static constexpr std::time_t kDefaultSpillHorizon = 60 * 60;
+
+    /// Values of `wake_at_`: the loop is polling, or it sleeps until something is added.
+    static constexpr int64_t kAwake = std::numeric_limits<int64_t>::min();
+    static constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+
+    /**
+     * @brief How far ahead a follow-up added from a worker may be due and still be kept on that worker.
+     */
+    static constexpr std::time_t kLocalHorizon = 1;
+
+    /**
+     * @brief Stores a task: straight into the skiplist or the MultiQueue if selected, through the ingest ring otherwise.
+     */
+    void Enqueue(std::function<void()>& callable, std::time_t timestamp, TaskKind kind, ExecutorId executor) {
+	if (backend_ == TimerBackend::SkipList || backend_ == TimerBackend::MultiQueue) {
+	    Task task {
+		.timestamp = timestamp,
+		.func = std::move(callable),
+		.kind = kind,
+		.executor = executor,
+	    };
+	    if (multi_queue_) {
+		multi_queue_->Insert(timestamp, std::move(task));
+	    } else {
+		skiplist_.Insert(timestamp, std::move(task));
+	    }
+	} else {
+	    // The ring has a single producer, while the application and any number of workers may add at once.
+	    std::lock_guard lock(producer_mutex_);
+	    if (tasks_buffer_.Full() && wake_mode_ == WakeMode::External) {
+		// Only `ProcessEvents` drains the ring, possibly called by this very thread later on: waiting for a slot
+		// could deadlock, so the task goes to the skiplist, which the loop always looks at, instead.
+		skiplist_.Insert(timestamp, Task {
+		    .timestamp = timestamp,
+		    .func = std::move(callable),
+		    .kind = kind,
+		    .executor = executor,
+		});
+	    } else {
+		if (tasks_buffer_.Full()) {
+		    // A sleeping loop would not drain the ring before the next deadline.
+		    Wake();
+		}
+		auto& slot = tasks_buffer_.Claim();
+		slot.timestamp = timestamp;
+		slot.func = std::move(callable);
+		slot.kind = kind;
+		slot.executor = executor;
+		tasks_buffer_.Commit();
+	    }
+	}
+	WakeBy(std::chrono::system_clock::from_time_t(timestamp) - handoff_lead_);
+    }
+
+    /**
+     * @brief Makes sure the event loop is awake by `due`, waking it at once if it planned to sleep longer.
+     *
+     * The loop publishes when it plans to wake up in `wake_at_`, or `kAwake` while it is polling; then nothing has
+     * to be done, as the loop looks at the stores again after publishing its next plan.
+     */
+    void WakeBy(std::chrono::system_clock::time_point due) {
+	if (wake_mode_ == WakeMode::BusyPoll) {
+	    return;
+	}
+
+	// Always writes, even if the plan stays, so that it is ordered against the exchange in `Plan`:
+	// either the loop sees the new task, or the task sees the loop's plan.
+	auto ticks = due.time_since_epoch().count();
+	auto planned = wake_at_.load(std::memory_order_relaxed);
+	while (!wake_at_.compare_exchange_weak(planned, std::min(planned, ticks), std::memory_order_acq_rel)) {
+	}
+	if (ticks < planned) {
+	    Wake();
+	}
+    }
+
+    /**
+     * @brief Returns the latest deadline due for dispatch: the current second, or the one `handoff_lead_` from now.
+     */
+    std::time_t HandoffNow() const {
+	using namespace std::chrono;
+	return system_clock::to_time_t(system_clock::now() + handoff_lead_);
+    }
+
+    /**
+     * @brief Returns when the event loop has to wake up next, in `system_clock` ticks, or `kNever` if nothing is pending.
+     *
+     * Tasks are due `handoff_lead_` before their deadline, hooks at their deadline, and a spilled task has to be
+     * read back at the first second at which it falls within the horizon.
+     */
+    int64_t NextWake() {
+	using namespace std::chrono;
+	auto ticks = [](int64_t deadline, microseconds lead) {
+	    // Deadlines beyond what the clock represents are as good as never; those before the epoch are simply due.
+	    if (deadline >= duration_cast<seconds>(system_clock::duration::max()).count() - 1) {
+		return kNever;
+	    }
+	    return (system_clock::from_time_t(std::max<int64_t>(deadline, 0)) - lead).time_since_epoch().count();
+	};
+
+	auto tasks = std::min(tasks_.NextDeadline(), skiplist_.NextDeadline());
+	if (multi_queue_) {
+	    tasks = std::min(tasks, multi_queue_->NextDeadline());
+	}
+	auto wake = ticks(tasks, handoff_lead_);
+
+	if (spill_) {
+	    if (auto spilled = spill_->NextDeadline(); spilled != std::numeric_limits<int64_t>::max()) {
+		wake = std::min(wake, ticks(spilled - spill_horizon_ + 1, microseconds::zero()));
+	    }
+	}
+
+	std::lock_guard lock(hooks_->mutex);
+	return std::min(wake, ticks(hooks_->list.NextDeadline(), microseconds::zero()));
+    }
+
+    /**
+     * @brief Publishes when the event loop wakes up next, once a `Poll` has dispatched everything due.
+     *
+     * @return The wake-up time in `system_clock` ticks, `kNever` if nothing is pending, or std::nullopt if something
+     *         arrived while polling, unnoticed by the poll, and the loop has to poll again right away.
+     */
+    std::optional<int64_t> Plan() {
+	auto wake = NextWake();
+	wake_at_.exchange(wake, std::memory_order_acq_rel);
+
+	// A producer that found the loop awake did not wake it, but what it stored before is visible by now.
+	if (!tasks_buffer_.Empty() || NextWake() < wake) {
+	    return std::nullopt;
+	}
+	return wake;
+    }
+
+    void Wake() {
+	if (service_) {
+	    service_->Ring();
+	    return;
+	}
+	if (timer_fd_) {
+	    timer_fd_->Notify();
+	    return;
+	}
+	wakeups_.fetch_add(1);
+	wakeup_wait_.NotifyOne(wakeups_);
+    }
+
+    /**
+     * @brief Arms the timerfd for a wake-up returned by `Plan`, or disarms it if nothing is pending.
+     */
+    void Arm(int64_t wake) {
+	if (wake == kNever) {
+	    timer_fd_->Disarm();
+	} else {
+	    timer_fd_->Arm(std::chrono::system_clock::time_point(std::chrono::system_clock::duration(wake)));
+	}
+    }
+
+    /**
+     * @brief Keeps a short-delay follow-up on the calling worker instead of sending it through the event loop.
+     *
+     * Applies only when the caller is a worker of the owned pool the task is routed to; the task then never
+     * crosses a thread. Far-future tasks still go to the event loop, so they do not pin the worker on shutdown.
+     * @return True if the task was taken over by the worker, false if it must be added the regular way.
+     */
+    bool TryAddLocal(std::function<void()>& callable, std::time_t timestamp, ExecutorId executor) {
+	// Validates the id for `Add`, so that `Dispatch` can index the executors unchecked later on.
+	auto* pool = executors_.at(executor).owned;
+	if (!pool || !pool->IsCurrentWorker()) {
+	    return false;
+	}
+
+	using namespace std::chrono;
+	if (timestamp > system_clock::to_time_t(system_clock::now()) + kLocalHorizon) {
+	    return false;
+	}
+
+	pool->AddLocal(std::move(callable), system_clock::from_time_t(timestamp));
+	return true;
+    }
+
+    /**
+     * @brief Turns a serialized task back into a callable.
+     *
+     * The callable shares ownership of the handler rather than referring to the scheduler, which a shared
+     * executor may outlive.
+     */
+    std::function<void()> Deserialize(SpillHandlerId handler, std::string_view payload) {
+	return [handler = spill_handlers_.at(handler), payload = std::string(payload)]() { (*handler)(payload); };
+    }
+
+    /**
+     * @brief Hands an expired task to the pool matching its kind and executor.
+     *
+     * With the MultiQueue backend, several dispatcher threads call this at once, so owned pools are fed through
+     * their locking `Execute` as well.
+     */
+    void Dispatch(Task& task) {
+	using namespace std::chrono;
+	if (auto not_before = system_clock::from_time_t(task.timestamp); handoff_lead_.count() && not_before > system_clock::now()) {
+	    // Nothing of the scheduler is captured but the wait policy, as the task may outlive it on a shared executor.
+	    task.func = [wait = handoff_wait_, func = std::move(task.func), not_before]() {
+		wait->SleepUntil(not_before);
+		func();
+	    };
+	}
+
+	if (task.kind == TaskKind::Blocking) {
+	    blocking_pool_.AddTask(std::move(task.func));
+	} else if (auto& target = executors_[task.executor]; target.owned && !multi_queue_) {
+	    // The event loop is the only producer of an owned pool, so the lock in Execute can be skipped.
+	    target.owned->AddTask(std::move(task.func));
+	} else {
+	    target.executor->Execute(std::move(task.func));
+	}
+    }
+
+    /**
+     * @brief Hands the queued invocation of an expired intrusive timer to the default executor.
+     *
+     * The invocation carries the hooks and its fire slot only, see `Hooks`.
+     */
+    void Dispatch(uint32_t fire) {
+	auto invoke = [hooks = hooks_.get(), fire]() { Hooks::Fire(hooks, fire); };
+	// What std::function stores inline, so that firing through a shared executor does not allocate either.
+	static_assert(std::is_trivially_copyable_v<decltype(invoke)> && sizeof(invoke) <= 2 * sizeof(void*));
+
+	if (auto& target = executors_[kDefaultExecutor]; target.owned && !multi_queue_) {
+	    target.owned->AddTask(invoke);
+	} else {
+	    target.executor->Execute(invoke);
+	}
+    }
+
     /**
      * @brief The event loop that continuously checks and executes tasks at their scheduled times.
+     *
+     * Unless it busy-polls, the loop sleeps between two polls until the earliest pending deadline, see `Plan`.
      */
     void EventLoop() {
-	while (!break_ || !tasks_.empty() || !tasks_buffer_.Empty()) {
-	    if (!tasks_buffer_.Empty()) {
-		tasks_.push_front(tasks_buffer_.PopUnsafe());
+	while (!break_ || !Idle()) {
+	    if (wake_mode_ == WakeMode::BusyPoll) {
+		Poll();
+		continue;
 	    }
 
-	    std::stack<std::list<Task>::iterator> to_remove;
+	    Poll();
+	    auto wakeups = wakeups_.load();
+	    auto wake = Plan();
+	    // Shutdown signals the loop only once, which may have been consumed already.
+	    if (!wake || (break_ && Idle())) {
+		continue;
+	    }
 
-	    for (auto it = tasks_.begin(); it != tasks_.end(); ++it) {
+	    if (timer_fd_) {
+		Arm(*wake);
+		timer_fd_->Wait();
+	    } else if (*wake == kNever) {
+		wakeup_wait_.Wait(wakeups_, wakeups);
+	    } else {
 		using namespace std::chrono;
-		auto timestamp_now = system_clock::to_time_t(system_clock::now());
+		wakeup_wait_.WaitUntil(wakeups_, wakeups, system_clock::time_point(system_clock::duration(*wake)));
+	    }
+	}
+    }
 
-		if (it->timestamp <= timestamp_now) {
-		    pool_.AddTask(std::move(it->func));
-		    to_remove.push(it);
-		} 
+    /**
+     * @brief The loop of the additional dispatcher threads: pops expired tasks from the MultiQueue.
+     *
+     * Between two rounds the dispatchers sleep on `dispatch_round_`, which the event loop advances whenever it
+     * finds expired tasks in the MultiQueue, and `Shutdown` once the event loop is gone.
+     */
+    void DispatchLoop() {
+	while (!break_ || !multi_queue_->Empty()) {
+	    auto round = dispatch_round_.load();
+	    multi_queue_->PopExpired(HandoffNow(), [this](Task&& task) { Dispatch(task); });
+	    if (!break_ || !multi_queue_->Empty()) {
+		dispatch_wait_.Wait(dispatch_round_, round);
 	    }
+	}
+    }
+
+    /**
+     * @brief One iteration of the event loop: ingests the newly added tasks and dispatches the expired ones.
+     *
+     * Incoming tasks are inspected directly in the ring: an already expired task is handed to the pool
+     * straight from its slot, without ever being stored in the pending tasks' store.
+     * Called either by `EventLoop` or by the timer service the scheduler is registered with.
+     */
+    void Poll() override {
+	using namespace std::chrono;
+	// Producers leave a polling loop alone, see `WakeBy`.
+	wake_at_.store(kAwake);
+	auto timestamp_now = system_clock::to_time_t(system_clock::now());
+	auto handoff_now = HandoffNow();
+
+	while (!tasks_buffer_.Empty()) {
+	    auto& incoming = tasks_buffer_.Peek();
 
-	    while (!to_remove.empty()) {
-		auto top = to_remove.top();
-		tasks_.erase(top);
-		to_remove.pop();
+	    if (incoming.timestamp <= handoff_now) {
+		Dispatch(incoming);
+	    } else {
+		tasks_.Push(incoming.timestamp, std::move(incoming));
 	    }
+
+	    tasks_buffer_.Release();
+	}
+
+	if (spill_ && timestamp_now != last_refill_) {
+	    last_refill_ = timestamp_now;
+	    spill_->Refill(timestamp_now + spill_horizon_, [this](int64_t deadline, SpillHandlerId handler, std::string_view payload) {
+		tasks_.Push(deadline, Task { .timestamp = deadline, .func = Deserialize(handler, payload) });
+	    });
 	}
+
+	tasks_.PopExpired(handoff_now, [this](Task&& task) { Dispatch(task); });
+	// Besides its own backend, the skiplist holds the tasks that found the ring full in `WakeMode::External`.
+	if (backend_ == TimerBackend::SkipList || !skiplist_.Empty()) {
+	    skiplist_.PopExpired(handoff_now, [this](Task&& task) { Dispatch(task); });
+	}
+	if (multi_queue_) {
+	    if (multi_queue_->NextDeadline() <= handoff_now) {
+		dispatch_round_.fetch_add(1);
+		dispatch_wait_.NotifyAll(dispatch_round_);
+	    }
+	    multi_queue_->PopExpired(handoff_now, [this](Task&& task) { Dispatch(task); });
+	}
+
+	// Expired hooks are dispatched outside the lock, as a full pool may wait for callbacks that re-arm.
+	{
+	    std::lock_guard lock(hooks_->mutex);
+	    hooks_->list.Expire(timestamp_now, [this](TimerHook&, uint32_t fire) { expired_hooks_.push_back(fire); });
+	}
+	for (auto fire: expired_hooks_) {
+	    Dispatch(fire);
+	}
+	expired_hooks_.clear();
+
+	if (service_ && break_ && Idle() && !drained_) {
+	    drained_ = 1;
+	    drained_wait_.NotifyAll(drained_);
+	}
+    }
+
+    /**
+     * @brief Tells the timer service when to poll next: right away while busy-polling, at the planned wake-up otherwise.
+     */
+    int64_t NextPoll() override {
+	if (wake_mode_ == WakeMode::BusyPoll) {
+	    return kAwake;
+	}
+	return Plan().value_or(kAwake);
+    }
+
+    /**
+     * @brief Checks whether there are neither pending nor newly added tasks, nor armed hooks.
+     */
+    bool Idle() const {
+	std::lock_guard lock(hooks_->mutex);
+	return tasks_.Empty() && tasks_buffer_.Empty() && skiplist_.Empty() && (!multi_queue_ || multi_queue_->Empty())
+	    && (!spill_ || spill_->Empty()) && hooks_->list.Empty();
     }
 
     std::thread event_loop_thread_;
+    TimerService* service_ = nullptr;
+    bool registered_ = false;
+    std::atomic<uint32_t> drained_ = 0;
+    FutexWait drained_wait_;
     std::atomic<bool> break_;
-    std::list<Task> tasks_; 
+    WakeMode wake_mode_ = WakeMode::BusyPoll;
+    std::atomic<uint32_t> wakeups_ = 0;
+    HybridWait wakeup_wait_;
+    std::unique_ptr<TimerFdLoop> timer_fd_;
+    std::atomic<int64_t> wake_at_ = kAwake; ///< When the loop plans to wake up, see `WakeBy` and `Plan`.
+    bool external_running_ = false;
+    std::chrono::microseconds handoff_lead_{0};
+    std::shared_ptr<HybridWait> handoff_wait_ = std::make_shared<HybridWait>(); ///< Shared by the workers, so they calibrate together.
+    TimerStore<Task> tasks_;
+    ConcurrentSkipList<Task> skiplist_;
+    std::unique_ptr<MultiQueue<Task>> multi_queue_;
+    TimerBackend backend_ = TimerBackend::Adaptive;
+    size_t dispatchers_count_ = kDefaultDispatchers;
+    size_t relaxation_ = kDefaultRelaxation;
+    std::vector<std::thread> dispatchers_;
+    std::atomic<uint32_t> dispatch_round_ = 0;
+    FutexWait dispatch_wait_;
+    std::unique_ptr<SpillStore> spill_;
+    std::time_t spill_horizon_ = kDefaultSpillHorizon;
+    std::time_t last_refill_ = 0;
+    std::vector<std::shared_ptr<const SpillHandler>> spill_handlers_;
     SPMCCircularBuffer<Task> tasks_buffer_;
-    ThreadPool pool_;
+    std::mutex producer_mutex_;
+    std::unique_ptr<Hooks, HooksRelease> hooks_{new Hooks};
+    std::vector<uint32_t> expired_hooks_;
+    std::vector<NamedExecutor> executors_;
+    BlockingPool blocking_pool_;
 };
 
 } // namespace scheduler
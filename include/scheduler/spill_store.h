@@ -0,0 +1,299 @@
+/**
+ * @file spill_store.h
+ * @brief Header file for the SpillStore class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Disk tier for far-future serializable tasks.
+ *
+ * @details
+ * A serializable task is a handler id plus an opaque payload. Far-future tasks are first collected in a small
+ * in-memory buffer; once the buffer holds `buffer_bytes`, it is sorted by deadline and written out as a run file,
+ * which is then memory-mapped and unlinked right away, so it disappears with the process. A run costs no heap
+ * memory, and its pages are clean and file-backed: the kernel can drop them at any time.
+ *
+ * The event loop calls `Refill` with the end of its in-memory window. Every run is sorted, so refilling streams
+ * each run sequentially from its current offset up to the first record outside the window; consumed pages are
+ * released with `MADV_DONTNEED`, and a fully consumed run is unmapped. Memory use is thus bounded by the buffer
+ * size plus the tasks inside the window, regardless of how many tasks are pending.
+ *
+ * If a run cannot be written, e.g. because the disk is full, its tasks stay in the buffer and the error is kept
+ * for `Error`. The next attempt is made only once the buffer has doubled in size, so a failing disk costs
+ * amortized constant work per task rather than a rewrite of the whole buffer on every `Add`.
+ *
+ * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
+ */
+class SpillStore {
+public:
+    /**
+     * @brief Constructs a SpillStore.
+     * @param directory The directory run files are created in, preferably on a local disk.
+     * @param buffer_bytes The size of the in-memory buffer, and thus of every run.
+     */
+    SpillStore(std::string directory, size_t buffer_bytes = kDefaultBufferBytes)
+	: directory_{std::move(directory)},
+	  buffer_limit_{buffer_bytes},
+	  flush_at_{buffer_bytes}
+    {}
+
+    /**
+     * @brief Unmaps every run; the files are already unlinked.
+     */
+    ~SpillStore() {
+	for (auto& run: runs_) {
+	    ::munmap(run.base, run.length);
+	}
+    }
+
+    SpillStore(const SpillStore&) = delete;
+    SpillStore(const SpillStore&&) = delete;
+    SpillStore& operator=(const SpillStore&)= delete;
+    SpillStore& operator=(SpillStore&&) = delete;
+
+    /**
+     * @brief Stores a far-future task, writing a run if the buffer is full. Safe to call from any thread.
+     *
+     * @param deadline The time at which the task should be executed.
+     * @param handler The id of the handler the payload is passed to.
+     * @param payload The serialized task.
+     */
+    void Add(int64_t deadline, uint32_t handler, std::string payload) {
+	std::lock_guard lock(mutex_);
+	buffer_bytes_ += RecordSize(payload.size());
+	buffer_next_ = std::min(buffer_next_, deadline);
+	buffer_.push_back(Entry { .deadline = deadline, .handler = handler, .payload = std::move(payload) });
+	size_.fetch_add(1, std::memory_order_relaxed);
+
+	if (buffer_bytes_ >= flush_at_) {
+	    auto error = Flush();
+	    error_.store(error, std::memory_order_relaxed);
+	    flush_at_ = error ? buffer_bytes_ * 2 : buffer_limit_;
+	}
+    }
+
+    /**
+     * @brief Takes out every task whose deadline is earlier than `until` and passes it to `fn`.
+     *
+     * @param until The end of the caller's in-memory window.
+     * @param fn Called as `fn(deadline, handler, payload)`; the payload is only valid during the call.
+     */
+    template<typename F>
+    void Refill(int64_t until, F&& fn) {
+	std::lock_guard lock(mutex_);
+	size_t taken = 0;
+
+	auto kept = std::partition(buffer_.begin(), buffer_.end(), [&](const Entry& entry) { return entry.deadline >= until; });
+	buffer_next_ = std::numeric_limits<int64_t>::max();
+	for (auto it = buffer_.begin(); it != kept; ++it) {
+	    buffer_next_ = std::min(buffer_next_, it->deadline);
+	}
+	for (auto it = kept; it != buffer_.end(); ++it) {
+	    buffer_bytes_ -= RecordSize(it->payload.size());
+	    fn(it->deadline, it->handler, std::string_view(it->payload));
+	    ++taken;
+	}
+	buffer_.erase(kept, buffer_.end());
+
+	for (auto& run: runs_) {
+	    while (run.offset < run.length) {
+		auto* record = reinterpret_cast<const Record*>(static_cast<const std::byte*>(run.base) + run.offset);
+		if (record->deadline >= until) {
+		    break;
+		}
+
+		fn(record->deadline, record->handler, std::string_view(reinterpret_cast<const char*>(record + 1), record->size));
+		run.offset += RecordSize(record->size);
+		++taken;
+	    }
+	    Release(run);
+	}
+	std::erase_if(runs_, [](const Run& run) { return run.base == nullptr; });
+
+	size_.fetch_sub(taken, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the earliest deadline held, or the maximum representable one if there is none.
+     *
+     * Costs one look at the head of every run: the buffer's minimum is maintained as tasks come and go.
+     */
+    int64_t NextDeadline() {
+	std::lock_guard lock(mutex_);
+	auto next = buffer_next_;
+	for (auto& run: runs_) {
+	    if (run.offset < run.length) {
+		next = std::min(next, reinterpret_cast<const Record*>(static_cast<const std::byte*>(run.base) + run.offset)->deadline);
+	    }
+	}
+	return next;
+    }
+
+    /**
+     * @brief Returns the number of tasks held, in the buffer and on disk.
+     */
+    size_t Size() const noexcept {
+	return size_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Checks whether no task is held.
+     */
+    bool Empty() const noexcept {
+	return Size() == 0;
+    }
+
+    /**
+     * @brief Returns why the last attempt to write a run failed, or no error if it succeeded.
+     */
+    std::error_code Error() const noexcept {
+	return std::error_code(error_.load(std::memory_order_relaxed), std::generic_category());
+    }
+
+    static constexpr size_t kDefaultBufferBytes = 4 << 20;
+
+private:
+    struct Entry {
+	int64_t deadline;
+	uint32_t handler;
+	std::string payload;
+    };
+
+    /**
+     * @struct Record
+     * @brief On-disk header of a task, followed by its payload and padded to 8 bytes.
+     */
+    struct Record {
+	int64_t deadline;
+	uint32_t handler;
+	uint32_t size;
+    };
+
+    struct Run {
+	void* base;
+	size_t length;
+	size_t offset = 0;
+	size_t released = 0; ///< The page-aligned prefix already handed back to the kernel.
+    };
+
+    static size_t RecordSize(size_t payload) noexcept {
+	return (sizeof(Record) + payload + 7) / 8 * 8;
+    }
+
+    /**
+     * @brief Writes the buffer out as a sorted run and maps it. Must be called under `mutex_`.
+     * @return Zero on success, the `errno` value of the failed call otherwise; the buffer is kept then.
+     */
+    int Flush() {
+	std::sort(buffer_.begin(), buffer_.end(), [](const Entry& lhs, const Entry& rhs) {
+	    return lhs.deadline < rhs.deadline;
+	});
+
+	std::string bytes(buffer_bytes_, '\0');
+	size_t offset = 0;
+	for (auto& entry: buffer_) {
+	    Record record { .deadline = entry.deadline, .handler = entry.handler, .size = static_cast<uint32_t>(entry.payload.size()) };
+	    std::memcpy(bytes.data() + offset, &record, sizeof(record));
+	    std::memcpy(bytes.data() + offset + sizeof(record), entry.payload.data(), entry.payload.size());
+	    offset += RecordSize(entry.payload.size());
+	}
+
+	auto path = directory_ + "/scheduler-spill-" + std::to_string(::getpid()) + "-"
+	    + std::to_string(reinterpret_cast<uintptr_t>(this)) + "-" + std::to_string(runs_created_++);
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd < 0) {
+	    return errno;
+	}
+	::unlink(path.c_str());
+
+	void* base = MAP_FAILED;
+	int error = WriteAll(fd, bytes);
+	if (!error) {
+	    base = ::mmap(nullptr, bytes.size(), PROT_READ, MAP_SHARED, fd, 0);
+	    error = base == MAP_FAILED ? errno : 0;
+	}
+	::close(fd);
+	if (error) {
+	    return error;
+	}
+
+	::madvise(base, bytes.size(), MADV_SEQUENTIAL);
+	runs_.push_back(Run { .base = base, .length = bytes.size() });
+	buffer_.clear();
+	buffer_bytes_ = 0;
+	buffer_next_ = std::numeric_limits<int64_t>::max();
+	return 0;
+    }
+
+    /**
+     * @return Zero on success, the `errno` value otherwise. A write that makes no progress counts as a full disk.
+     */
+    static int WriteAll(int fd, std::string_view bytes) noexcept {
+	while (!bytes.empty()) {
+	    auto written = ::write(fd, bytes.data(), bytes.size());
+	    if (written < 0) {
+		return errno;
+	    }
+	    if (written == 0) {
+		return ENOSPC;
+	    }
+	    bytes.remove_prefix(static_cast<size_t>(written));
+	}
+	return 0;
+    }
+
+    /**
+     * @brief Hands the consumed pages of a run back to the kernel, unmapping the run once it is fully consumed.
+     */
+    static void Release(Run& run) noexcept {
+	if (run.offset == run.length) {
+	    ::munmap(run.base, run.length);
+	    run.base = nullptr;
+	    return;
+	}
+
+	auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	auto consumed = run.offset / page * page;
+	if (consumed > run.released) {
+	    ::madvise(static_cast<std::byte*>(run.base) + run.released, consumed - run.released, MADV_DONTNEED);
+	    run.released = consumed;
+	}
+    }
+
+    std::string directory_;
+    size_t buffer_limit_;
+    size_t flush_at_; ///< The buffer size at which the next run is written; raised while writing fails.
+    std::atomic<int> error_ = 0;
+    std::mutex mutex_;
+    std::vector<Entry> buffer_;
+    size_t buffer_bytes_ = 0;
+    int64_t buffer_next_ = std::numeric_limits<int64_t>::max(); ///< The earliest deadline in the buffer.
+    std::vector<Run> runs_;
+    size_t runs_created_ = 0;
+    std::atomic<size_t> size_ = 0;
+};
+
+} // namespace internal
+} // namespace scheduler
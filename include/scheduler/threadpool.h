@@ -5,13 +5,21 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 #include <thread>
+#include <type_traits>
 
-#include "circular_buffer.h"
+#include "executor.h"
+#include "record_buffer.h"
+#include "wait_strategy.h"
 
 namespace scheduler {
 namespace internal {
@@ -21,12 +29,24 @@ namespace internal {
  * @brief A simple thread pool implementation for managing and executing tasks concurrently.
  *
  * The ThreadPool class allows you to add tasks to a queue and have them executed by a pool of threads.
- * It uses a circular buffer to store tasks and provides methods to start and stop the execution of tasks.
+ * It stores tasks inline in a variable-length record ring, so callables and their captures reach the workers
+ * without heap allocation, and provides methods to start and stop the execution of tasks.
+ *
+ * Idle workers park on their own slot and register in a LIFO stack. Each added task unparks exactly one worker,
+ * the one that went idle most recently and therefore has the warmest cache, instead of waking every sleeper.
+ * A `Fn` added while some worker is idle skips the shared ring altogether: it is deposited into that worker's
+ * single-slot mailbox, so dispatch costs one wake-up and no contention on the read lock.
+ *
+ * `AddTask` may only be called by a single producer thread. Through the `Executor` interface the pool accepts tasks
+ * from any number of threads, which lets several schedulers share it.
+ *
+ * A task running on a worker can also schedule continuations on that very worker with `AddLocal`. They go to a
+ * worker-local LIFO queue, or a worker-local timer heap if they are not due yet, and never cross threads.
  *
  * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
  */
 
-class ThreadPool {
+class ThreadPool : public Executor {
 public:
     /**
      * @typedef Fn
@@ -38,12 +58,18 @@ public:
      * @brief Constructs a ThreadPool with a specified number of threads and buffer size.
      *
      * @param threads_amount The number of threads to be created in the pool.
-     * @param buffer_size The size of the circular buffer used to store tasks.
+     * @param buffer_size The number of average-sized tasks the task ring should hold.
+     * @param max_batch The maximum number of tasks a worker claims per acquisition of the queue lock.
+     *                  The default of 1 disables batching.
      */
-    ThreadPool(size_t threads_amount, size_t buffer_size)
+    ThreadPool(size_t threads_amount, size_t buffer_size, size_t max_batch = 1)
 	: threads_amount_{threads_amount},
-	  tasks_buffer_{buffer_size}
-    {}
+	  max_batch_{std::max<size_t>(max_batch, 1)},
+	  tasks_buffer_{buffer_size * kTaskBytes},
+	  parking_{std::make_unique<ParkingSlot[]>(threads_amount)}
+    {
+	idle_.reserve(threads_amount);
+    }
 
     /**
      * @brief Destructor for the ThreadPool class.
@@ -52,7 +78,7 @@ public:
      * It calls the `Shutdown` method to signal all worker threads to stop processing tasks and waits for them to finish execution.
      * This guarantees that all resources are released and no threads are left running in the background.
      */
-    ~ThreadPool() {
+    ~ThreadPool() override {
 	Shutdown();
     }
 
@@ -65,12 +91,79 @@ public:
      * @brief Adds a new task to the thread pool's task queue.
      *
      * This method allows you to enqueue a task, represented as a callable object, to be executed by the thread pool.
+     * The callable is constructed directly inside the task ring together with its captures.
+     * A `Fn` is handed straight to an idle worker's mailbox instead, and goes through the ring only when every worker is busy.
      * @param task A callable object (e.g., a lambda, function pointer, or std::function) representing the task to be executed.
      */
-    void AddTask(Fn task) {
-	tasks_buffer_.EmplacePush(std::move(task));
+    template<typename F>
+    void AddTask(F&& task) {
+	submitted_.fetch_add(1, std::memory_order_relaxed);
+
+	if constexpr (std::is_same_v<std::remove_cvref_t<F>, Fn>) {
+	    if (TryHandOff(task)) {
+		return;
+	    }
+	}
+
+	tasks_buffer_.Push(std::forward<F>(task));
+	WakeOne();
     } 
 
+    /**
+     * @brief Checks whether the calling thread is one of this pool's workers.
+     */
+    bool IsCurrentWorker() const noexcept {
+	return current_pool_ == this;
+    }
+
+    /**
+     * @brief Schedules a continuation on the calling worker itself.
+     *
+     * A due continuation is pushed onto the worker's local LIFO queue and runs as soon as the current task returns,
+     * while its data is still in cache; a later one goes to the worker's local timer heap. Neither touches the shared
+     * ring or any other thread.
+     *
+     * @param task The task to be executed.
+     * @param when The earliest time the task may run.
+     *
+     * @warning May only be called from a task running on this pool, see `IsCurrentWorker`.
+     */
+    void AddLocal(Fn task, std::chrono::system_clock::time_point when) {
+	submitted_.fetch_add(1, std::memory_order_relaxed);
+	auto& slot = *current_slot_;
+
+	if (when <= std::chrono::system_clock::now()) {
+	    slot.local_queue.push_back(std::move(task));
+	} else {
+	    slot.local_timers.push_back(LocalTimer { .when = when, .func = std::move(task) });
+	    std::push_heap(slot.local_timers.begin(), slot.local_timers.end(), LocalTimer::Later);
+	}
+    }
+
+    /**
+     * @brief Adds a new task to the thread pool's task queue from any thread.
+     *
+     * Serializes concurrent producers with a lock and then behaves like `AddTask`.
+     * @param task The task to be executed.
+     */
+    void Execute(Fn task) override {
+	std::lock_guard lock(producer_mutex_);
+	AddTask(std::move(task));
+    }
+
+    /**
+     * @brief Returns a snapshot of the pool's counters.
+     */
+    PoolMetrics Metrics() const noexcept override {
+	return PoolMetrics {
+	    .submitted = submitted_.load(std::memory_order_relaxed),
+	    .completed = completed_.load(std::memory_order_relaxed),
+	    .queued = tasks_buffer_.Size(),
+	    .threads = alive_.load(std::memory_order_relaxed),
+	    .peak_threads = threads_amount_,
+	};
+    }
+
     /**
      * @brief Starts the execution of tasks by launching the worker threads.
      * 
@@ -81,7 +174,7 @@ public:
 	break_ = false;
 
 	for (size_t i = 0; i < threads_amount_; ++i) {
-	    threads_.emplace_back(std::bind(&ThreadPool::Worker, this));
+	    threads_.emplace_back(std::bind(&ThreadPool::Worker, this, i));
 	}
     }
 
@@ -94,6 +187,15 @@ public:
     void Shutdown() {
 	break_ = true;
 
+	{
+	    std::lock_guard lock(idle_mutex_);
+	    for (auto index: idle_) {
+		Unpark(index);
+	    }
+	    idle_.clear();
+	    idle_count_ = 0;
+	}
+
 	for (auto& thread: threads_) {
 	    thread.join();
 	}
@@ -102,30 +204,235 @@ public:
     }
 
 private:
+    /**
+     * @struct LocalTimer
+     * @brief A continuation waiting in a worker's local timer heap.
+     */
+    struct LocalTimer {
+	std::chrono::system_clock::time_point when;
+	Fn func;
+
+	static bool Later(const LocalTimer& lhs, const LocalTimer& rhs) noexcept {
+	    return lhs.when > rhs.when;
+	}
+    };
+
+    /**
+     * @struct ParkingSlot
+     * @brief Per-worker state: the futex word an idle worker sleeps on, its single-slot task mailbox and its local
+     * continuations, padded to its own cache line. Only the mailbox and the futex word are touched by other threads.
+     */
+    struct alignas(64) ParkingSlot {
+	std::atomic<uint32_t> unparked = 0;
+	FutexWait wait;
+	Fn mailbox;
+	std::vector<Fn> local_queue;
+	std::vector<LocalTimer> local_timers;
+    };
+
+    /**
+     * @brief The maximum number of local continuations a worker runs before looking at the shared queue again.
+     */
+    static constexpr size_t kLocalBurst = 64;
+
     /**
      * @brief The worker function executed by each thread in the pool.
      * 
-     * This function runs in a loop, continuously attempting to fetch tasks from the task queue.
-     * If a task is available, it is executed. The loop continues until the pool is signaled to shut down
-     * and the task queue is empty.
+     * This function runs in a loop, executing tasks in place inside the ring for as long as there are any,
+     * claiming up to `BatchSize` of them at a time.
+     * When the queue runs dry the worker pushes itself onto the idle stack and parks on its own slot until
+     * `WakeOne`, `TryHandOff` or `Shutdown` unparks it, then runs whatever was left in its mailbox.
+     * The loop continues until the pool is signaled to shut down and the task queue is empty.
+     *
+     * @param index The index of the worker's parking slot.
+     */
+    void Worker(size_t index) {
+	auto& slot = parking_[index];
+	current_pool_ = this;
+	current_slot_ = &slot;
+	alive_.fetch_add(1, std::memory_order_relaxed);
+
+	while (!break_ || !tasks_buffer_.Empty() || !slot.local_queue.empty() || !slot.local_timers.empty()) {
+	    if (RunLocal(slot)) {
+		continue;
+	    }
+
+	    if (auto executed = tasks_buffer_.TryConsumeBatch(BatchSize())) {
+		completed_.fetch_add(executed, std::memory_order_relaxed);
+		continue;
+	    }
+
+	    slot.unparked = 0;
+	    {
+		std::lock_guard lock(idle_mutex_);
+		idle_.push_back(index);
+		idle_count_ = idle_.size();
+	    }
+
+	    // A task or shutdown that raced with the registration above would not see this worker as idle.
+	    if (tasks_buffer_.Empty() && slot.local_queue.empty()) {
+		if (!slot.local_timers.empty()) {
+		    slot.wait.WaitUntil(slot.unparked, 0u, slot.local_timers.front().when);
+		} else if (!break_) {
+		    slot.wait.Wait(slot.unparked, 0u);
+		}
+	    }
+
+	    if (!slot.unparked) {
+		std::lock_guard lock(idle_mutex_);
+		if (auto it = std::find(idle_.begin(), idle_.end(), index); it != idle_.end()) {
+		    idle_.erase(it);
+		    idle_count_ = idle_.size();
+		}
+	    }
+
+	    if (slot.mailbox) {
+		std::invoke(slot.mailbox);
+		slot.mailbox = nullptr;
+		completed_.fetch_add(1, std::memory_order_relaxed);
+	    }
+	}
+
+	alive_.fetch_sub(1, std::memory_order_relaxed);
+	current_pool_ = nullptr;
+	current_slot_ = nullptr;
+    }
+
+    /**
+     * @brief Moves due local timers to the local queue and runs up to `kLocalBurst` local continuations, newest first.
+     *
+     * @return True if any continuation was executed.
      */
-    void Worker() {
-	while (!break_ || !tasks_buffer_.Empty()) {
-	    using namespace std::chrono_literals;
-	    auto task = tasks_buffer_.TryPopFor(500ms);
+    bool RunLocal(ParkingSlot& slot) {
+	if (!slot.local_timers.empty()) {
+	    auto now = std::chrono::system_clock::now();
+	    while (!slot.local_timers.empty() && slot.local_timers.front().when <= now) {
+		std::pop_heap(slot.local_timers.begin(), slot.local_timers.end(), LocalTimer::Later);
+		slot.local_queue.push_back(std::move(slot.local_timers.back().func));
+		slot.local_timers.pop_back();
+	    }
+	}
 
-	    if (task) {
-		std::invoke(task.value());
+	size_t executed = 0;
+	while (!slot.local_queue.empty() && executed < kLocalBurst) {
+	    auto task = std::move(slot.local_queue.back());
+	    slot.local_queue.pop_back();
+	    std::invoke(task);
+	    ++executed;
+	}
+
+	completed_.fetch_add(executed, std::memory_order_relaxed);
+	return executed != 0;
+    }
+
+    /**
+     * @brief Picks how many tasks a worker should claim at once.
+     *
+     * A worker takes its fair share of the current backlog, capped by `max_batch_`. While the queue is shallower
+     * than the number of workers every claim is a single task, so one worker never hoards work the others could
+     * start right away.
+     */
+    size_t BatchSize() const noexcept {
+	if (max_batch_ == 1) {
+	    return 1;
+	}
+	return std::clamp<size_t>(tasks_buffer_.Size() / std::max<size_t>(threads_amount_, 1), 1, max_batch_);
+    }
+
+    /**
+     * @brief Unparks the most recently parked worker, if any worker is idle.
+     *
+     * The slot is flagged under the lock, so a worker that is not found on the idle stack is guaranteed to see
+     * its flag set; only the futex wake itself happens outside the lock.
+     */
+    void WakeOne() {
+	if (idle_count_ == 0) {
+	    return;
+	}
+
+	size_t index;
+	{
+	    std::lock_guard lock(idle_mutex_);
+	    if (idle_.empty()) {
+		return;
 	    }
+
+	    index = idle_.back();
+	    idle_.pop_back();
+	    idle_count_ = idle_.size();
+	    parking_[index].unparked = 1;
+	}
+
+	parking_[index].wait.NotifyOne(parking_[index].unparked);
+    }
+
+    /**
+     * @brief Deposits a task into the mailbox of the most recently parked worker and unparks it.
+     *
+     * @param task The task to hand off; it is moved from only on success.
+     * @return True if an idle worker took the task, false if every worker is busy.
+     */
+    bool TryHandOff(Fn& task) {
+	if (idle_count_ == 0) {
+	    return false;
+	}
+
+	size_t index;
+	{
+	    std::lock_guard lock(idle_mutex_);
+	    if (idle_.empty()) {
+		return false;
+	    }
+
+	    index = idle_.back();
+	    idle_.pop_back();
+	    idle_count_ = idle_.size();
+	    parking_[index].mailbox = std::move(task);
+	    parking_[index].unparked = 1;
 	}
+
+	parking_[index].wait.NotifyOne(parking_[index].unparked);
+	return true;
     }
 
+    /**
+     * @brief Unparks a worker that has already been removed from the idle stack. Must be called under `idle_mutex_`.
+     */
+    void Unpark(size_t index) noexcept {
+	parking_[index].unparked = 1;
+	parking_[index].wait.NotifyOne(parking_[index].unparked);
+    }
+
+    /**
+     * @brief Ring bytes reserved per task: a record header plus room for a `std::function` or a lambda with a few captures.
+     */
+    static constexpr size_t kTaskBytes = 128;
+
+    static inline thread_local ThreadPool* current_pool_ = nullptr;
+    static inline thread_local ParkingSlot* current_slot_ = nullptr;
+
     size_t threads_amount_;
+    size_t max_batch_;
     std::vector<std::thread> threads_;
-    SPMCCircularBuffer<Fn> tasks_buffer_;
+    SPMCRecordBuffer<> tasks_buffer_;
+    std::unique_ptr<ParkingSlot[]> parking_;
+    std::mutex producer_mutex_;
+    std::mutex idle_mutex_;
+    std::vector<size_t> idle_;
+    std::atomic<size_t> idle_count_ = 0;
+    std::atomic<size_t> submitted_ = 0;
+    std::atomic<size_t> completed_ = 0;
+    std::atomic<size_t> alive_ = 0;
     std::atomic<bool> break_ = false;
 };
 
 
 } // namespace internal
+
+/**
+ * @typedef ThreadPool
+ * @brief The built-in fixed-size pool, for applications that create one up front and share it between schedulers.
+ */
+using ThreadPool = internal::ThreadPool;
+
 } // namespace scheduler
@@ -0,0 +1,298 @@
+/**
+ * @file timer_hook.h
+ * @brief Header file for the TimerHook class.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace scheduler {
+namespace internal {
+class TimerHookList;
+} // namespace internal
+
+/**
+ * @class TimerHook
+ * @brief An intrusive timer that users embed in their own objects, e.g. one per connection for its timeout.
+ *
+ * @details
+ * Arming a hook with `Scheduler::Arm` links the hook itself into the scheduler's timer store: nothing is
+ * allocated, no `std::function` is constructed and nothing is copied through the scheduler's ring. Re-arming
+ * an armed hook only moves its deadline, and `Scheduler::Disarm` unlinks it in amortized
+ * logarithmic time.
+ *
+ * When the deadline expires, the hook is unlinked and `callback` is invoked with the hook on a pool thread.
+ * Disarming or re-arming the hook before the callback has started cancels that invocation.
+ * The usual pattern is to derive the owning object from `TimerHook` and `static_cast` back to it in the callback.
+ *
+ * @warning A hook must not be destroyed or moved while it is armed, while its invocation is queued (unless it has
+ *          been disarmed since) or while its callback is running.
+ */
+class TimerHook {
+public:
+    using Callback = void (*)(TimerHook&);
+
+    /**
+     * @brief Constructs an unarmed hook.
+     * @param callback The function invoked with this hook once its deadline expires.
+     */
+    explicit TimerHook(Callback callback) noexcept
+	: callback_{callback}
+    {}
+
+    TimerHook(const TimerHook&) = delete;
+    TimerHook(const TimerHook&&) = delete;
+    TimerHook& operator=(const TimerHook&)= delete;
+    TimerHook& operator=(TimerHook&&) = delete;
+
+    /**
+     * @brief Returns the deadline the hook was last armed with.
+     */
+    std::time_t Deadline() const noexcept {
+	return deadline_;
+    }
+
+private:
+    friend class internal::TimerHookList;
+
+    Callback callback_;
+    std::time_t deadline_ = 0;
+    TimerHook* child_ = nullptr;
+    TimerHook* next_ = nullptr;
+    TimerHook* prev_ = nullptr; ///< The previous sibling, or the parent of a leftmost child.
+    bool linked_ = false;
+    uint32_t fire_ = 0; ///< One plus the fire slot of the queued invocation of the callback, zero if there is none.
+};
+
+namespace internal {
+
+/**
+ * @class TimerHookList
+ * @brief Intrusive pairing heap of armed hooks. Not thread-safe; the scheduler guards it with a mutex.
+ *
+ * @details
+ * Linking a hook and moving its deadline earlier take constant time; unlinking a hook and popping the earliest one
+ * take amortized logarithmic time. Expiring hooks touches only the expired ones, however many hooks are armed.
+ *
+ * An expired hook is not fired right away but queued on a pool. Until the queued invocation claims the hook
+ * with `Claim`, unlinking or re-linking the hook cancels the invocation, after which the hook may be destroyed:
+ * the invocation only carries the index of a fire slot owned by the list, which points back to the hook until it is
+ * cancelled. Slots are recycled, so once the list has seen its peak of queued invocations, neither expiring nor
+ * cancelling allocates.
+ */
+class TimerHookList {
+public:
+    /**
+     * @brief Links a hook with a new deadline, or only moves the deadline if the hook is linked already.
+     * @return True if the hook was not linked before, false otherwise.
+     */
+    bool Link(TimerHook& hook, std::time_t deadline) {
+	if (hook.linked_) {
+	    // An earlier deadline keeps the heap order within the hook's subtree, so the subtree moves as a whole.
+	    if (deadline < hook.deadline_ && &hook != root_) {
+		Detach(hook);
+	    } else {
+		Remove(hook);
+	    }
+	    hook.deadline_ = deadline;
+	    root_ = Meld(root_, &hook);
+	    return false;
+	}
+
+	Cancel(hook);
+	hook.deadline_ = deadline;
+	hook.child_ = hook.next_ = hook.prev_ = nullptr;
+	hook.linked_ = true;
+	root_ = Meld(root_, &hook);
+	return true;
+    }
+
+    /**
+     * @brief Unlinks a hook, or cancels its queued invocation if it has expired already.
+     * @return True if the hook was linked or its invocation was pending, false otherwise.
+     */
+    bool Unlink(TimerHook& hook) {
+	if (hook.linked_) {
+	    Remove(hook);
+	    hook.linked_ = false;
+	    return true;
+	}
+	return Cancel(hook);
+    }
+
+    /**
+     * @brief Unlinks every hook whose deadline is not later than `now` and passes it to `fire`, in deadline order,
+     *        together with the identifier its invocation has to `Claim` the hook with.
+     */
+    template<typename F>
+    void Expire(std::time_t now, F&& fire) {
+	while (root_ && root_->deadline_ <= now) {
+	    auto* hook = root_;
+	    Remove(*hook);
+	    hook->linked_ = false;
+	    hook->fire_ = AcquireSlot(*hook) + 1;
+	    fire(*hook, hook->fire_ - 1);
+	}
+    }
+
+    /**
+     * @brief Claims an expired hook for its queued invocation and releases the invocation's fire slot.
+     * @param fire The identifier passed to `Expire` along with the hook. Must be claimed exactly once.
+     * @return The hook whose callback should be invoked, or nullptr if the invocation has been cancelled.
+     */
+    TimerHook* Claim(uint32_t fire) {
+	auto* hook = slots_[fire];
+	free_slots_.push_back(fire);
+	if (hook) {
+	    hook->fire_ = 0;
+	}
+	return hook;
+    }
+
+    /**
+     * @brief Returns the number of invocations queued by `Expire` and not claimed yet.
+     */
+    size_t Queued() const noexcept {
+	return slots_.size() - free_slots_.size();
+    }
+
+    /**
+     * @brief Invokes the callback of a hook claimed with `Claim`.
+     */
+    static void Fire(TimerHook& hook) {
+	hook.callback_(hook);
+    }
+
+    /**
+     * @brief Returns the earliest deadline of a linked hook, or the maximum representable time if there is none.
+     */
+    std::time_t NextDeadline() const noexcept {
+	return root_ ? root_->deadline_ : std::numeric_limits<std::time_t>::max();
+    }
+
+    /**
+     * @brief Checks whether no hook is linked.
+     */
+    bool Empty() const noexcept {
+	return root_ == nullptr;
+    }
+
+private:
+    /**
+     * @brief Cancels the queued invocation of an expired hook, if any.
+     */
+    bool Cancel(TimerHook& hook) {
+	if (!hook.fire_) {
+	    return false;
+	}
+	slots_[hook.fire_ - 1] = nullptr;
+	hook.fire_ = 0;
+	return true;
+    }
+
+    /**
+     * @brief Takes a free fire slot, growing the slots only if every one is in use, and points it at `hook`.
+     */
+    uint32_t AcquireSlot(TimerHook& hook) {
+	if (free_slots_.empty()) {
+	    slots_.push_back(&hook);
+	    free_slots_.reserve(slots_.capacity());
+	    return static_cast<uint32_t>(slots_.size() - 1);
+	}
+
+	auto slot = free_slots_.back();
+	free_slots_.pop_back();
+	slots_[slot] = &hook;
+	return slot;
+    }
+
+    /**
+     * @brief Merges two heaps and returns the root of the result. Both roots must have no siblings.
+     */
+    static TimerHook* Meld(TimerHook* lhs, TimerHook* rhs) noexcept {
+	if (!lhs || !rhs) {
+	    return lhs ? lhs : rhs;
+	}
+	if (rhs->deadline_ < lhs->deadline_) {
+	    std::swap(lhs, rhs);
+	}
+
+	rhs->prev_ = lhs;
+	rhs->next_ = lhs->child_;
+	if (lhs->child_) {
+	    lhs->child_->prev_ = rhs;
+	}
+	lhs->child_ = rhs;
+	return lhs;
+    }
+
+    /**
+     * @brief Cuts a hook other than the root, together with its subtree, out of the heap.
+     */
+    static void Detach(TimerHook& hook) noexcept {
+	if (hook.prev_->child_ == &hook) {
+	    hook.prev_->child_ = hook.next_;
+	} else {
+	    hook.prev_->next_ = hook.next_;
+	}
+	if (hook.next_) {
+	    hook.next_->prev_ = hook.prev_;
+	}
+	hook.next_ = hook.prev_ = nullptr;
+    }
+
+    /**
+     * @brief Takes a hook out of the heap, merging its children back in.
+     */
+    void Remove(TimerHook& hook) noexcept {
+	if (&hook == root_) {
+	    root_ = MergePairs(hook.child_);
+	} else {
+	    Detach(hook);
+	    root_ = Meld(root_, MergePairs(hook.child_));
+	}
+	hook.child_ = nullptr;
+    }
+
+    /**
+     * @brief Merges a list of siblings into a single heap: pairwise from left to right, then from right to left.
+     */
+    static TimerHook* MergePairs(TimerHook* first) noexcept {
+	TimerHook* pairs = nullptr;
+	while (first) {
+	    auto* lhs = first;
+	    auto* rhs = lhs->next_;
+	    first = rhs ? rhs->next_ : nullptr;
+
+	    lhs->next_ = lhs->prev_ = nullptr;
+	    if (rhs) {
+		rhs->next_ = rhs->prev_ = nullptr;
+		lhs = Meld(lhs, rhs);
+	    }
+	    // The merged pairs are stacked through `next_`, so the second pass runs from right to left.
+	    lhs->next_ = pairs;
+	    pairs = lhs;
+	}
+
+	TimerHook* root = nullptr;
+	while (pairs) {
+	    auto* next = pairs->next_;
+	    pairs->next_ = nullptr;
+	    root = Meld(root, pairs);
+	    pairs = next;
+	}
+	return root;
+    }
+
+    TimerHook* root_ = nullptr;
+    std::vector<TimerHook*> slots_; ///< The hook of each queued invocation, nullptr once cancelled.
+    std::vector<uint32_t> free_slots_;
+};
+
+} // namespace internal
+} // namespace scheduler
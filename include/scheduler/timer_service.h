@@ -0,0 +1,213 @@
+/**
+ * @file timer_service.h
+ * @brief Header file for the TimerService class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "wait_strategy.h"
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @class TimerClient
+ * @brief Anything a `TimerService` can drive: one call to `Poll` is one iteration of the client's event loop.
+ */
+class TimerClient {
+public:
+    virtual ~TimerClient() = default;
+
+    /**
+     * @brief Ingests newly added tasks and dispatches the expired ones. Called from the service's loop thread only.
+     */
+    virtual void Poll() = 0;
+
+    /**
+     * @brief Returns when the client has to be polled next, in `system_clock` ticks. Called right after `Poll`.
+     *
+     * A time that has passed already asks to be polled again at once, the maximum value to be polled only once
+     * rung. From then on, the client calls `TimerService::Ring` whenever something is due earlier than that.
+     */
+    virtual int64_t NextPoll() = 0;
+};
+
+} // namespace internal
+
+/**
+ * @class TimerService
+ * @brief A single event-loop thread multiplexing any number of schedulers.
+ *
+ * Every standalone `Scheduler` spends a thread on its event loop. Schedulers constructed with a `TimerService`
+ * do not; they register into the service on `Run` and are polled, one after another, by its only loop thread.
+ * A process can thus host hundreds of logical schedulers with a constant number of timer threads, typically
+ * all of them sharing `TimerService::Global()`.
+ *
+ * After each round, the loop thread sleeps until the earliest time any client asked to be polled again, sleeping
+ * and spinning like `HybridWait`. A client that gets something due earlier rings the service's doorbell with `Ring`.
+ * The loop thread is started by the first registration and sleeps while no scheduler is registered.
+ *
+ * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
+ */
+class TimerService {
+public:
+    TimerService() = default;
+
+    /**
+     * @brief Stops and joins the loop thread. All schedulers must have been shut down before.
+     */
+    ~TimerService() {
+	{
+	    std::lock_guard lock(mutex_);
+	    break_ = true;
+	}
+	cv_.notify_all();
+	Ring();
+
+	if (thread_.joinable()) {
+	    thread_.join();
+	}
+    }
+
+    TimerService(const TimerService&) = delete;
+    TimerService(const TimerService&&) = delete;
+    TimerService& operator=(const TimerService&)= delete;
+    TimerService& operator=(TimerService&&) = delete;
+
+    /**
+     * @brief Returns the process-wide service instance.
+     */
+    static TimerService& Global() {
+	static TimerService service;
+	return service;
+    }
+
+    /**
+     * @brief Adds a client to the set polled by the loop thread, starting the thread if needed.
+     * @param client The client to poll.
+     */
+    void Register(internal::TimerClient* client) {
+	{
+	    std::lock_guard lock(mutex_);
+	    clients_.push_back(client);
+
+	    if (!thread_.joinable()) {
+		thread_ = std::thread(&TimerService::Loop, this);
+	    }
+	}
+	cv_.notify_all();
+	// The loop may be sleeping for the other clients, while the new one may have tasks due already.
+	Ring();
+    }
+
+    /**
+     * @brief Removes a client from the polled set.
+     *
+     * When this method returns, the client is not being polled and will not be polled again.
+     * @param client The client to remove. Must not be called from the loop thread.
+     */
+    void Unregister(internal::TimerClient* client) {
+	uint64_t epoch;
+	{
+	    std::lock_guard lock(mutex_);
+	    auto it = std::find(clients_.begin(), clients_.end(), client);
+	    if (it == clients_.end()) {
+		return;
+	    }
+
+	    clients_.erase(it);
+	    if (!polling_) {
+		return;
+	    }
+	    epoch = epoch_.load();
+	}
+
+	// The loop may still be polling the client from a snapshot taken in the current iteration.
+	auto current = epoch_.load();
+	while (current == epoch) {
+	    epoch_wait_.Wait(epoch_, current);
+	    current = epoch_.load();
+	}
+    }
+
+    /**
+     * @brief Wakes the loop thread up for a new round. Called by clients whose next poll moved earlier.
+     */
+    void Ring() noexcept {
+	doorbell_.fetch_add(1);
+	wait_.NotifyOne(doorbell_);
+    }
+
+    /**
+     * @brief Returns the number of registered clients.
+     */
+    size_t Size() const {
+	std::lock_guard lock(mutex_);
+	return clients_.size();
+    }
+
+private:
+    /**
+     * @brief The loop executed by the service thread: polls a snapshot of the clients, then publishes a new epoch
+     * so that `Unregister` knows the snapshot is no longer in use, and sleeps until the earliest next poll.
+     */
+    void Loop() {
+	using namespace std::chrono;
+	for (;;) {
+	    {
+		std::unique_lock lock(mutex_);
+		cv_.wait(lock, [this] { return break_ || !clients_.empty(); });
+		if (break_) {
+		    return;
+		}
+		snapshot_.assign(clients_.begin(), clients_.end());
+		polling_ = true;
+	    }
+
+	    // Loaded before polling: a client ringing from now on makes the wait below return at once.
+	    auto doorbell = doorbell_.load();
+	    auto wake = std::numeric_limits<int64_t>::max();
+	    for (auto* client: snapshot_) {
+		client->Poll();
+		wake = std::min(wake, client->NextPoll());
+	    }
+
+	    {
+		std::lock_guard lock(mutex_);
+		polling_ = false;
+		epoch_.fetch_add(1);
+	    }
+	    epoch_wait_.NotifyAll(epoch_);
+
+	    if (wake == std::numeric_limits<int64_t>::max()) {
+		wait_.Wait(doorbell_, doorbell);
+	    } else if (auto deadline = system_clock::time_point(system_clock::duration(wake)); deadline > system_clock::now()) {
+		wait_.WaitUntil(doorbell_, doorbell, deadline);
+	    }
+	}
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<internal::TimerClient*> clients_;
+    std::vector<internal::TimerClient*> snapshot_;
+    std::atomic<uint64_t> epoch_ = 0;
+    internal::FutexWait epoch_wait_;
+    std::atomic<uint32_t> doorbell_ = 0;
+    internal::HybridWait wait_;
+    std::thread thread_;
+    bool polling_ = false;
+    bool break_ = false;
+};
+
+} // namespace scheduler
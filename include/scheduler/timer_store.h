@@ -0,0 +1,296 @@
+/**
+ * @file timer_store.h
+ * @brief Header file for the TimerStore class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <variant>
+
+#include "compact_heap.h"
+#include "deadline_array.h"
+#include "ladder_queue.h"
+#include "radix_heap.h"
+
+namespace scheduler {
+
+/**
+ * @enum TimerBackend
+ * @brief Selects the data structure holding a scheduler's pending tasks.
+ */
+enum class TimerBackend {
+    Array, ///< Unordered dense deadline array with a SIMD expiry scan, see `DeadlineArray`. Best for small sets.
+    RadixHeap, ///< Monotone radix heap, see `RadixHeap`. Best for large sets with few expiries per poll.
+    Ladder, ///< Ladder queue, see `LadderQueue`. Best for large sets whose deadlines span from seconds to months.
+    Adaptive, ///< Picks `Array`, `RadixHeap`, `Ladder` or `Compact` from the observed workload and switches as it changes.
+    SkipList, ///< Lock-free skiplist that `Add` inserts into directly, from any number of threads, see `ConcurrentSkipList`.
+    MultiQueue, ///< Relaxed concurrent priority queue popped by several dispatcher threads, see `MultiQueue`.
+    Compact, ///< 4-ary heap of 16-byte entries over a slab of tasks, see `CompactHeap`. Best for very large, long-lived sets.
+};
+
+/**
+ * @struct TimerMetrics
+ * @brief A snapshot of the state of a scheduler's timer store and of the figures the adaptive selection relies on.
+ */
+struct TimerMetrics {
+    TimerBackend backend = TimerBackend::Array; ///< The backend new tasks currently go to.
+    bool adaptive = false; ///< Whether the backend is picked at runtime.
+    bool migrating = false; ///< Whether tasks are still being moved over from the previous backend.
+    size_t pending = 0; ///< Tasks waiting for their deadline.
+    size_t migrations = 0; ///< Backend switches so far.
+    double insert_rate = 0; ///< Tasks stored per second, over the last evaluation period.
+    int64_t deadline_spread = 0; ///< How far ahead, in seconds, the latest deadline stored in the last period lies.
+    size_t small_set_threshold = 0; ///< Above this many pending tasks, an adaptive store leaves `Array`.
+    size_t large_set_threshold = 0; ///< Above this many pending tasks, renewed slowly, an adaptive store picks `Compact`.
+    int64_t wide_spread_threshold = 0; ///< Above this spread, an adaptive store prefers `Ladder` to `RadixHeap`.
+};
+
+namespace internal {
+
+/**
+ * @brief A timer store whose backend can be chosen, and changed, at runtime.
+ *
+ * @details
+ * The backends are held in a `std::variant`, so every operation is a single switch followed by a statically
+ * dispatched, inlinable call, instead of one virtual call per expired entry.
+ *
+ * The workload figures are updated once per `kEvaluationPeriod` whatever the backend, so that the metrics stay fresh.
+ * With `TimerBackend::Adaptive`, the store also picks its backend from them: small sets stay in the array, whose
+ * scan is cheapest below `kSmallSet` entries. Sets beyond `kLargeSet` entries that the insert rate renews more slowly
+ * than once per `kSlowTurnover` go to the compact heap, where memory, not the cost of an insert, dominates.
+ * Others go to the radix heap, or to the ladder queue once deadlines spread beyond `kWideSpread`. Every threshold
+ * has hysteresis so that a workload hovering around it does not make the store flip back and forth.
+ *
+ * Switching never stops dispatch: new entries go to the new backend right away, the old backend keeps being
+ * polled for expired entries, and at most `kMigrationBatch` entries are moved over per `PopExpired`.
+ *
+ * @tparam T The value stored with every deadline.
+ */
+template<typename T>
+class TimerStore {
+public:
+    /**
+     * @brief Constructs an empty adaptive store, starting with the array backend.
+     */
+    TimerStore() {
+	Publish();
+    }
+
+    /**
+     * @brief Adds a value with its deadline.
+     */
+    void Push(int64_t deadline, T value) {
+	++inserts_;
+	window_latest_ = std::max(window_latest_, deadline);
+	std::visit([&](auto& store) { store.Push(deadline, std::move(value)); }, active_);
+    }
+
+    /**
+     * @brief Removes every value whose deadline is not later than `now` and passes it to `fn`.
+     *
+     * Also moves a batch of entries over if a backend switch is in progress, and re-evaluates the workload, and the
+     * backend if it is adaptive, once the evaluation period has passed.
+     */
+    template<typename F>
+    void PopExpired(int64_t now, F&& fn) {
+	if (migrating_) {
+	    std::visit([&](auto& store) { store.PopExpired(now, fn); }, retiring_);
+	    Migrate(kMigrationBatch);
+	}
+	std::visit([&](auto& store) { store.PopExpired(now, fn); }, active_);
+
+	if (now >= last_evaluation_ + kEvaluationPeriod) {
+	    Evaluate(now);
+	}
+    }
+
+    /**
+     * @brief Switches to another backend at once, moving every stored value over, or enables adaptive selection.
+     */
+    void SetBackend(TimerBackend backend) {
+	adaptive_ = backend == TimerBackend::Adaptive;
+	if (!adaptive_) {
+	    StartMigration(backend);
+	}
+	Migrate(std::numeric_limits<size_t>::max());
+	Publish();
+    }
+
+    /**
+     * @brief Returns the backend new values currently go to.
+     */
+    TimerBackend Backend() const noexcept {
+	return kBackends[active_.index()];
+    }
+
+    /**
+     * @brief Returns the metrics published by the last evaluation or backend change. Safe to call from any thread.
+     */
+    TimerMetrics Metrics() const {
+	std::lock_guard lock(metrics_mutex_);
+	return metrics_;
+    }
+
+    /**
+     * @brief Returns the earliest stored deadline, or the maximum representable one if there is none.
+     *
+     * Values still waiting to be migrated count too.
+     */
+    int64_t NextDeadline() {
+	auto next = [](auto& store) { return store.NextDeadline(); };
+	auto retiring = migrating_ ? std::visit(next, retiring_) : std::numeric_limits<int64_t>::max();
+	return std::min(std::visit(next, active_), retiring);
+    }
+
+    /**
+     * @brief Returns the number of stored values.
+     */
+    size_t Size() const noexcept {
+	auto size = [](auto& store) { return store.Size(); };
+	return std::visit(size, active_) + (migrating_ ? std::visit(size, retiring_) : 0);
+    }
+
+    /**
+     * @brief Checks whether no value is stored.
+     */
+    bool Empty() const noexcept {
+	return Size() == 0;
+    }
+
+    static constexpr size_t kSmallSet = 1024; ///< Up to this many entries, scanning the array beats any ordering.
+    static constexpr size_t kLargeSet = size_t(1) << 20; ///< From this many entries on, the set's memory is what counts.
+    static constexpr int64_t kSlowTurnover = 60; ///< Seconds it takes inserts to renew a set the compact heap suits.
+    static constexpr int64_t kWideSpread = 24 * 60 * 60; ///< From this spread on, the ladder beats the radix heap.
+    static constexpr int64_t kEvaluationPeriod = 1; ///< Seconds between two evaluations of the workload.
+    static constexpr size_t kMigrationBatch = 256; ///< Entries moved to the new backend per `PopExpired`.
+
+private:
+    using Store = std::variant<DeadlineArray<T>, RadixHeap<T>, LadderQueue<T>, CompactHeap<T>>;
+
+    /// The backend of every alternative of `Store`, by index.
+    static constexpr TimerBackend kBackends[] = {
+	TimerBackend::Array, TimerBackend::RadixHeap, TimerBackend::Ladder, TimerBackend::Compact,
+    };
+
+    static Store Make(TimerBackend backend) {
+	switch (backend) {
+	    case TimerBackend::RadixHeap: return RadixHeap<T>{};
+	    case TimerBackend::Ladder: return LadderQueue<T>{};
+	    case TimerBackend::Compact: return CompactHeap<T>{};
+	    default: return DeadlineArray<T>{};
+	}
+    }
+
+    /**
+     * @brief Redirects new values to another backend; the current one becomes the retiring one.
+     */
+    void StartMigration(TimerBackend backend) {
+	if (backend == Backend()) {
+	    return;
+	}
+
+	Migrate(std::numeric_limits<size_t>::max());
+	retiring_ = std::move(active_);
+	active_ = Make(backend);
+	migrating_ = true;
+	++migrations_;
+    }
+
+    /**
+     * @brief Moves up to `max` values from the retiring backend to the active one.
+     */
+    void Migrate(size_t max) {
+	if (!migrating_) {
+	    return;
+	}
+
+	std::visit([&](auto& from) {
+	    from.Extract(max, [&](int64_t deadline, T&& value) {
+		std::visit([&](auto& to) { to.Push(deadline, std::move(value)); }, active_);
+	    });
+	}, retiring_);
+
+	if (std::visit([](auto& store) { return store.Empty(); }, retiring_)) {
+	    retiring_ = Store{};
+	    migrating_ = false;
+	}
+    }
+
+    /**
+     * @brief Updates the workload figures, picks the backend suiting them and publishes the metrics.
+     */
+    void Evaluate(int64_t now) {
+	auto elapsed = last_evaluation_ ? std::max<int64_t>(now - last_evaluation_, 1) : kEvaluationPeriod;
+	insert_rate_ = static_cast<double>(inserts_) / static_cast<double>(elapsed);
+	if (inserts_) {
+	    spread_ = std::max<int64_t>(window_latest_ - now, 0);
+	}
+	inserts_ = 0;
+	window_latest_ = std::numeric_limits<int64_t>::min();
+	last_evaluation_ = now;
+
+	if (adaptive_ && !migrating_) {
+	    StartMigration(Pick(Size()));
+	}
+	Publish();
+    }
+
+    /**
+     * @brief The adaptive policy. Leaving a backend takes a clearer signal than entering it.
+     */
+    TimerBackend Pick(size_t pending) const noexcept {
+	auto current = Backend();
+
+	auto small = current == TimerBackend::Array ? kSmallSet : kSmallSet / 2;
+	if (pending <= small) {
+	    return TimerBackend::Array;
+	}
+
+	auto large = current == TimerBackend::Compact ? kLargeSet / 2 : kLargeSet;
+	auto turnover = current == TimerBackend::Compact ? kSlowTurnover / 2 : kSlowTurnover;
+	if (pending > large && insert_rate_ * static_cast<double>(turnover) < static_cast<double>(pending)) {
+	    return TimerBackend::Compact;
+	}
+
+	auto wide = current == TimerBackend::Ladder ? kWideSpread / 2 : kWideSpread;
+	return spread_ > wide ? TimerBackend::Ladder : TimerBackend::RadixHeap;
+    }
+
+    void Publish() {
+	std::lock_guard lock(metrics_mutex_);
+	metrics_ = TimerMetrics {
+	    .backend = Backend(),
+	    .adaptive = adaptive_,
+	    .migrating = migrating_,
+	    .pending = Size(),
+	    .migrations = migrations_,
+	    .insert_rate = insert_rate_,
+	    .deadline_spread = spread_,
+	    .small_set_threshold = kSmallSet,
+	    .large_set_threshold = kLargeSet,
+	    .wide_spread_threshold = kWideSpread,
+	};
+    }
+
+    Store active_;
+    Store retiring_;
+    bool migrating_ = false;
+    bool adaptive_ = true;
+    size_t migrations_ = 0;
+    size_t inserts_ = 0;
+    int64_t window_latest_ = std::numeric_limits<int64_t>::min();
+    int64_t last_evaluation_ = 0;
+    int64_t spread_ = 0;
+    double insert_rate_ = 0;
+    mutable std::mutex metrics_mutex_;
+    TimerMetrics metrics_;
+};
+
+} // namespace internal
+} // namespace scheduler
@@ -0,0 +1,166 @@
+/**
+ * @file timerfd_loop.h
+ * @brief Header file for the TimerFdLoop class.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Kernel-driven wake-ups for an event loop: a timerfd for the next deadline and an eventfd for everything else.
+ *
+ * @details
+ * Both descriptors are registered in an epoll instance of their own. That epoll descriptor is readable whenever
+ * the timer has expired or the loop has been notified, so it can be waited on directly with `Wait`, or handed to
+ * an application's own epoll (or poll, or select) loop, which then calls into the scheduler once it is readable.
+ *
+ * The timer is armed with an absolute `CLOCK_REALTIME` expiry, the clock deadlines are expressed in, and an idle
+ * loop costs no CPU at all. Only available on Linux; elsewhere `Valid` returns false.
+ *
+ * @note This class is designed to be non-copyable and non-movable to ensure unique ownership of its resources.
+ */
+class TimerFdLoop {
+public:
+    /**
+     * @brief Creates the descriptors. Check `Valid` for success.
+     */
+    TimerFdLoop() {
+#if defined(__linux__)
+	epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+	timer_ = ::timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+	event_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (epoll_ < 0 || timer_ < 0 || event_ < 0 || !Register(timer_) || !Register(event_)) {
+	    Close();
+	}
+#endif
+    }
+
+    ~TimerFdLoop() {
+	Close();
+    }
+
+    TimerFdLoop(const TimerFdLoop&) = delete;
+    TimerFdLoop(const TimerFdLoop&&) = delete;
+    TimerFdLoop& operator=(const TimerFdLoop&)= delete;
+    TimerFdLoop& operator=(TimerFdLoop&&) = delete;
+
+    /**
+     * @brief Checks whether the descriptors could be created.
+     */
+    bool Valid() const noexcept {
+	return epoll_ >= 0;
+    }
+
+    /**
+     * @brief Returns the epoll descriptor, readable while the timer has expired or a notification is pending.
+     */
+    int Fd() const noexcept {
+	return epoll_;
+    }
+
+    /**
+     * @brief Makes the descriptor readable at `deadline`, replacing the previous expiry.
+     */
+    void Arm(std::chrono::system_clock::time_point deadline) noexcept {
+#if defined(__linux__)
+	using namespace std::chrono;
+	// An all-zero expiry would disarm the timer, so a deadline at or before the epoch fires after 1 ns instead.
+	auto since_epoch = std::max<int64_t>(duration_cast<nanoseconds>(deadline.time_since_epoch()).count(), 1);
+	itimerspec spec {
+	    .it_interval = {},
+	    .it_value = {
+		.tv_sec = static_cast<time_t>(since_epoch / 1'000'000'000),
+		.tv_nsec = static_cast<long>(since_epoch % 1'000'000'000),
+	    },
+	};
+	::timerfd_settime(timer_, TFD_TIMER_ABSTIME, &spec, nullptr);
+#endif
+    }
+
+    /**
+     * @brief Cancels the pending expiry, if any.
+     */
+    void Disarm() noexcept {
+#if defined(__linux__)
+	itimerspec spec {};
+	::timerfd_settime(timer_, 0, &spec, nullptr);
+#endif
+    }
+
+    /**
+     * @brief Makes the descriptor readable right away. Safe to call from any thread.
+     */
+    void Notify() noexcept {
+#if defined(__linux__)
+	uint64_t one = 1;
+	[[maybe_unused]] auto written = ::write(event_, &one, sizeof(one));
+#endif
+    }
+
+    /**
+     * @brief Blocks until the timer expires or a notification arrives, then consumes both.
+     */
+    void Wait() noexcept {
+#if defined(__linux__)
+	epoll_event events[2];
+	while (::epoll_wait(epoll_, events, 2, -1) < 0 && errno == EINTR) {
+	}
+	Drain();
+#endif
+    }
+
+    /**
+     * @brief Consumes the pending expiry and notifications, so the descriptor is no longer readable.
+     */
+    void Drain() noexcept {
+#if defined(__linux__)
+	uint64_t count;
+	[[maybe_unused]] auto expirations = ::read(timer_, &count, sizeof(count));
+	[[maybe_unused]] auto notifications = ::read(event_, &count, sizeof(count));
+#endif
+    }
+
+private:
+#if defined(__linux__)
+    bool Register(int fd) noexcept {
+	epoll_event event {
+	    .events = EPOLLIN,
+	    .data = { .fd = fd },
+	};
+	return ::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+#endif
+
+    void Close() noexcept {
+#if defined(__linux__)
+	for (int* fd: { &epoll_, &timer_, &event_ }) {
+	    if (*fd >= 0) {
+		::close(*fd);
+		*fd = -1;
+	    }
+	}
+#endif
+    }
+
+    int epoll_ = -1;
+    int timer_ = -1;
+    int event_ = -1;
+};
+
+} // namespace internal
+} // namespace scheduler
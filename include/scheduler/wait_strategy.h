@@ -0,0 +1,414 @@
+/**
+ * @file wait_strategy.h
+ * @brief Header file for the wait strategies used by the circular buffers.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace scheduler {
+namespace internal {
+
+/**
+ * @brief Hints the CPU that the calling thread is spinning.
+ *
+ * @details
+ * Issues `pause` on x86 and `yield` on ARM, which lowers power consumption and frees pipeline resources
+ * for the sibling hyper-thread. Does nothing on other architectures.
+ */
+inline void CpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * @brief Wait strategy that burns a core spinning on the atomic with `CpuRelax` between polls.
+ *
+ * @details
+ * Lowest possible wake-up latency: a waiter notices the change within nanoseconds, and notifying costs nothing.
+ * Every waiting thread fully occupies a core, so use it only with dedicated, isolated cores.
+ *
+ * A wait strategy is a small object owned next to the atomic it guards and provides:
+ * - `Wait(atom, old)`: blocks while `atom == old`.
+ * - `WaitUntil(atom, old, deadline)`: same, but gives up at `deadline`, returning false on timeout.
+ * - `NotifyOne(atom)` / `NotifyAll(atom)`: wakes waiters after `atom` has been changed.
+ */
+struct SpinWait {
+    template<typename T>
+    void Wait(const std::atomic<T>& atom, T old) noexcept {
+	while (atom.load() == old) {
+	    CpuRelax();
+	}
+    }
+
+    template<typename T, typename Clock, typename Duration>
+    bool WaitUntil(const std::atomic<T>& atom, T old, const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+	while (atom.load() == old) {
+	    if (Clock::now() >= deadline) {
+		return false;
+	    }
+	    CpuRelax();
+	}
+	return true;
+    }
+
+    template<typename T>
+    void NotifyOne(std::atomic<T>&) noexcept {}
+
+    template<typename T>
+    void NotifyAll(std::atomic<T>&) noexcept {}
+};
+
+/**
+ * @brief Wait strategy that polls the atomic and yields the core to the OS scheduler between polls.
+ *
+ * @details
+ * Wake-up latency stays in the low microseconds while other runnable threads still get CPU time,
+ * but an idle waiter keeps showing up as busy.
+ */
+struct YieldWait {
+    template<typename T>
+    void Wait(const std::atomic<T>& atom, T old) noexcept {
+	while (atom.load() == old) {
+	    std::this_thread::yield();
+	}
+    }
+
+    template<typename T, typename Clock, typename Duration>
+    bool WaitUntil(const std::atomic<T>& atom, T old, const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+	while (atom.load() == old) {
+	    if (Clock::now() >= deadline) {
+		return false;
+	    }
+	    std::this_thread::yield();
+	}
+	return true;
+    }
+
+    template<typename T>
+    void NotifyOne(std::atomic<T>&) noexcept {}
+
+    template<typename T>
+    void NotifyAll(std::atomic<T>&) noexcept {}
+};
+
+/**
+ * @brief Wait strategy that spins briefly, then yields, then sleeps with exponential backoff.
+ *
+ * @details
+ * Short waits are served almost as fast as by `SpinWait`, while long waits cost close to no CPU.
+ * The price is wake-up latency of up to `kMaxSleep` once the waiter has backed off completely.
+ */
+struct BackoffWait {
+    static constexpr int kSpins = 128;
+    static constexpr int kYields = 16;
+    static constexpr std::chrono::microseconds kMinSleep{1};
+    static constexpr std::chrono::microseconds kMaxSleep{1000};
+
+    template<typename T>
+    void Wait(const std::atomic<T>& atom, T old) noexcept {
+	WaitUntil(atom, old, std::chrono::steady_clock::time_point::max());
+    }
+
+    template<typename T, typename Clock, typename Duration>
+    bool WaitUntil(const std::atomic<T>& atom, T old, const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+	auto sleep = kMinSleep;
+
+	for (int round = 0; atom.load() == old; ++round) {
+	    if (round < kSpins) {
+		CpuRelax();
+		continue;
+	    }
+
+	    auto now = Clock::now();
+	    if (now >= deadline) {
+		return false;
+	    }
+
+	    if (round < kSpins + kYields) {
+		std::this_thread::yield();
+	    } else {
+		std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(sleep, deadline - now));
+		sleep = std::min(sleep * 2, kMaxSleep);
+	    }
+	}
+	return true;
+    }
+
+    template<typename T>
+    void NotifyOne(std::atomic<T>&) noexcept {}
+
+    template<typename T>
+    void NotifyAll(std::atomic<T>&) noexcept {}
+};
+
+/**
+ * @brief Wait strategy that puts waiters to sleep in the kernel until they are explicitly notified.
+ *
+ * @details
+ * The default strategy: an idle waiter costs no CPU at all, and a wake-up costs one system call plus a context switch.
+ * On Linux the strategy talks to the futex directly, which also gives it a precise timed wait; notifications skip the
+ * system call while nobody is waiting. The futex word is the low 32 bits of the atomic, so 64-bit counters are supported
+ * as long as they do not advance by an exact multiple of 2^32 between a load and the following wait.
+ * Elsewhere it falls back to `std::atomic::wait` and a `BackoffWait` for timed waits.
+ */
+class FutexWait {
+public:
+    template<typename T>
+    void Wait(const std::atomic<T>& atom, T old) noexcept {
+#if defined(__linux__)
+	waiters_.fetch_add(1);
+	while (atom.load() == old) {
+	    Futex(Word(atom), FUTEX_WAIT_PRIVATE, static_cast<uint32_t>(old), nullptr);
+	}
+	waiters_.fetch_sub(1);
+#else
+	atom.wait(old);
+#endif
+    }
+
+    template<typename T, typename Clock, typename Duration>
+    bool WaitUntil(const std::atomic<T>& atom, T old, const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+#if defined(__linux__)
+	using namespace std::chrono;
+	auto steady_deadline = steady_clock::now() + duration_cast<nanoseconds>(deadline - Clock::now());
+	auto since_epoch = duration_cast<nanoseconds>(steady_deadline.time_since_epoch());
+	timespec abs_time {
+	    .tv_sec = static_cast<time_t>(since_epoch.count() / 1'000'000'000),
+	    .tv_nsec = static_cast<long>(since_epoch.count() % 1'000'000'000),
+	};
+
+	waiters_.fetch_add(1);
+	bool changed = true;
+	while (atom.load() == old) {
+	    if (steady_clock::now() >= steady_deadline) {
+		changed = false;
+		break;
+	    }
+	    Futex(Word(atom), FUTEX_WAIT_BITSET_PRIVATE, static_cast<uint32_t>(old), &abs_time, FUTEX_BITSET_MATCH_ANY);
+	}
+	waiters_.fetch_sub(1);
+	return changed;
+#else
+	return BackoffWait{}.WaitUntil(atom, old, deadline);
+#endif
+    }
+
+    template<typename T>
+    void NotifyOne(std::atomic<T>& atom) noexcept {
+#if defined(__linux__)
+	if (waiters_.load() != 0) {
+	    Futex(Word(atom), FUTEX_WAKE_PRIVATE, 1, nullptr);
+	}
+#else
+	atom.notify_one();
+#endif
+    }
+
+    template<typename T>
+    void NotifyAll(std::atomic<T>& atom) noexcept {
+#if defined(__linux__)
+	if (waiters_.load() != 0) {
+	    Futex(Word(atom), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+	}
+#else
+	atom.notify_all();
+#endif
+    }
+
+private:
+#if defined(__linux__)
+    template<typename T>
+    static uint32_t* Word(const std::atomic<T>& atom) noexcept {
+	static_assert(sizeof(std::atomic<T>) == sizeof(T) && (sizeof(T) == 4 || sizeof(T) == 8),
+		      "futex waits require a lock-free 32 or 64 bit atomic");
+	auto* word = reinterpret_cast<uint32_t*>(const_cast<std::atomic<T>*>(&atom));
+	return std::endian::native == std::endian::big ? word + sizeof(T) / 4 - 1 : word;
+    }
+
+    static void Futex(uint32_t* word, int op, uint32_t value, const timespec* timeout, uint32_t bitset = 0) noexcept {
+	syscall(SYS_futex, word, op, value, timeout, nullptr, bitset);
+    }
+#endif
+
+    std::atomic<uint32_t> waiters_ = 0;
+};
+
+/**
+ * @brief Wait strategy for timed waits that must end on time: sleeps in the kernel, then spins for the last stretch.
+ *
+ * @details
+ * A timed wait sleeps on the futex until `SpinWindow()` before the deadline, then spins with `CpuRelax` until the
+ * deadline itself. The kernel wakes sleepers late by a scheduler- and load-dependent amount; as long as the window
+ * covers that overshoot, the waiter is already running and spinning when the deadline hits.
+ *
+ * The window calibrates itself: every sleep that times out measures how late it woke up, and the window follows a
+ * slowly decaying peak of these overshoots, within `kMinSpin` and `kMaxSpin`. Untimed waits and notifications behave
+ * exactly like `FutexWait`. `SleepUntil` waits for a point in time alone, with `clock_nanosleep` instead of the futex.
+ */
+class HybridWait {
+public:
+    static constexpr std::chrono::nanoseconds kMinSpin{5'000};
+    static constexpr std::chrono::nanoseconds kInitialSpin{50'000};
+    static constexpr std::chrono::nanoseconds kMaxSpin{2'000'000};
+
+    template<typename T>
+    void Wait(const std::atomic<T>& atom, T old) noexcept {
+	futex_.Wait(atom, old);
+    }
+
+    template<typename T, typename Clock, typename Duration>
+    bool WaitUntil(const std::atomic<T>& atom, T old, const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+	auto wake = deadline - SpinWindow();
+	if (Clock::now() < wake) {
+	    if (futex_.WaitUntil(atom, old, wake)) {
+		return true;
+	    }
+	    Calibrate(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - wake));
+	}
+
+	while (atom.load() == old) {
+	    if (Clock::now() >= deadline) {
+		return false;
+	    }
+	    CpuRelax();
+	}
+	return true;
+    }
+
+    /**
+     * @brief Blocks until `deadline` without waiting on any atomic, sleeping and spinning like `WaitUntil`.
+     */
+    template<typename Clock, typename Duration>
+    void SleepUntil(const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+	auto wake = deadline - SpinWindow();
+	if (Clock::now() < wake) {
+	    Sleep(wake);
+	    Calibrate(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - wake));
+	}
+
+	while (Clock::now() < deadline) {
+	    CpuRelax();
+	}
+    }
+
+    template<typename T>
+    void NotifyOne(std::atomic<T>& atom) noexcept {
+	futex_.NotifyOne(atom);
+    }
+
+    template<typename T>
+    void NotifyAll(std::atomic<T>& atom) noexcept {
+	futex_.NotifyAll(atom);
+    }
+
+    /**
+     * @brief Returns how long before a deadline a timed wait currently stops sleeping and starts spinning.
+     */
+    std::chrono::nanoseconds SpinWindow() const noexcept {
+	return std::chrono::nanoseconds{spin_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    template<typename Clock, typename Duration>
+    static void Sleep(const std::chrono::time_point<Clock, Duration>& wake) noexcept {
+#if defined(__linux__)
+	using namespace std::chrono;
+	auto since_epoch = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch() + (wake - Clock::now()));
+	timespec abs_time {
+	    .tv_sec = static_cast<time_t>(since_epoch.count() / 1'000'000'000),
+	    .tv_nsec = static_cast<long>(since_epoch.count() % 1'000'000'000),
+	};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &abs_time, nullptr) == EINTR) {
+	}
+#else
+	std::this_thread::sleep_until(wake);
+#endif
+    }
+
+    /**
+     * @brief Feeds the overshoot of one sleep into the window: a new peak is taken at once, and decays by 1/8 per sleep.
+     */
+    void Calibrate(std::chrono::nanoseconds overshoot) noexcept {
+	auto peak = peak_.load(std::memory_order_relaxed);
+	peak = std::max(overshoot.count(), peak - peak / 8);
+	peak_.store(peak, std::memory_order_relaxed);
+	spin_.store(std::clamp(peak + peak / 4, kMinSpin.count(), kMaxSpin.count()), std::memory_order_relaxed);
+    }
+
+    FutexWait futex_;
+    std::atomic<int64_t> peak_ = kInitialSpin.count();
+    std::atomic<int64_t> spin_ = kInitialSpin.count();
+};
+
+/**
+ * @brief A timed mutex whose contended path is driven by a wait strategy.
+ *
+ * @details
+ * Meets the standard TimedLockable requirements, so it works with `std::lock_guard` and `std::unique_lock`.
+ * With `SpinWait` it degenerates into a spin lock, with `FutexWait` into a classic sleeping mutex.
+ *
+ * @tparam Wait The wait strategy used while the lock is contended.
+ */
+template<typename Wait>
+class WaitLock {
+public:
+    void lock() noexcept {
+	while (locked_.exchange(1)) {
+	    wait_.Wait(locked_, 1u);
+	}
+    }
+
+    bool try_lock() noexcept {
+	return !locked_.exchange(1);
+    }
+
+    template<typename Rep, typename Period>
+    bool try_lock_for(const std::chrono::duration<Rep, Period>& timeout) noexcept {
+	return try_lock_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    template<typename Clock, typename Duration>
+    bool try_lock_until(const std::chrono::time_point<Clock, Duration>& deadline) noexcept {
+	while (locked_.exchange(1)) {
+	    if (!wait_.WaitUntil(locked_, 1u, deadline)) {
+		return try_lock();
+	    }
+	}
+	return true;
+    }
+
+    void unlock() noexcept {
+	locked_ = 0;
+	wait_.NotifyOne(locked_);
+    }
+
+private:
+    std::atomic<uint32_t> locked_ = 0;
+    [[no_unique_address]] Wait wait_;
+};
+
+} // namespace internal
+} // namespace scheduler
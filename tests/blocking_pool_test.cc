@@ -0,0 +1,46 @@
+#include <atomic>
+#include <chrono>
+
+#include "check.h"
+#include "scheduler/blocking_pool.h"
+
+using namespace scheduler::internal;
+using namespace std::chrono;
+
+namespace {
+
+// The pool spawns a thread per blocked task up to its limit, queues the rest, and retires idle threads again.
+void TestGrowsAndShrinks() {
+    constexpr size_t kMaxThreads = 4;
+    BlockingPool pool(kMaxThreads, milliseconds(50));
+    std::atomic<size_t> started = 0;
+    std::atomic<bool> release = false;
+    auto task = [&]() {
+	++started;
+	CHECK(test::WaitFor([&]() { return release.load(); }));
+    };
+
+    pool.Run();
+    CHECK(pool.Metrics().threads == 0);
+    for (size_t i = 0; i < kMaxThreads + 1; ++i) {
+	pool.AddTask(task);
+    }
+
+    CHECK(test::WaitFor([&]() { return started == kMaxThreads; }));
+    auto busy = pool.Metrics();
+    CHECK(busy.threads == kMaxThreads);
+    CHECK(busy.queued == 1);
+
+    release = true;
+    CHECK(test::WaitFor([&]() { return pool.Metrics().completed == kMaxThreads + 1; }));
+    CHECK(test::WaitFor([&]() { return pool.Metrics().threads == 0; }));
+    CHECK(pool.Metrics().peak_threads == kMaxThreads);
+    pool.Shutdown();
+}
+
+} // namespace
+
+int main() {
+    TestGrowsAndShrinks();
+    return 0;
+}
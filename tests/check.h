@@ -0,0 +1,42 @@
+/**
+ * @file check.h
+ * @brief Minimal assertion helpers shared by the tests.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+/**
+ * @brief Aborts the test with the failed condition unless `cond` holds. Unlike `assert`, never compiled out.
+ */
+#define CHECK(cond)                                                                         \
+    do {                                                                                    \
+	if (!(cond)) {                                                                      \
+	    std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);  \
+	    std::abort();                                                                   \
+	}                                                                                   \
+    } while (0)
+
+namespace test {
+
+/**
+ * @brief Polls `cond` until it holds or `limit` has passed.
+ * @return True if the condition held in time.
+ */
+template<typename F>
+bool WaitFor(F&& cond, std::chrono::milliseconds limit = std::chrono::milliseconds(5000)) {
+    auto deadline = std::chrono::steady_clock::now() + limit;
+    while (!cond()) {
+	if (std::chrono::steady_clock::now() >= deadline) {
+	    return false;
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace test
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "bench.h"
+#include "check.h"
+#include "scheduler/circular_buffer.h"
+
+using scheduler::internal::SPMCCircularBuffer;
+using namespace std::chrono;
+
+namespace {
+
+// An empty buffer makes TryPopFor sleep for the whole limit rather than return at once or poll.
+void TestTimesOut() {
+    SPMCCircularBuffer<int> buffer(4);
+
+    auto cpu = bench::CpuTime(RUSAGE_THREAD);
+    auto start = steady_clock::now();
+    CHECK(!buffer.TryPopFor(milliseconds(100)));
+    CHECK(steady_clock::now() - start >= milliseconds(100));
+    CHECK(bench::CpuTime(RUSAGE_THREAD) - cpu < milliseconds(10));
+}
+
+// Idle consumers cost next to no CPU, and the one holding the read lock wakes up right after a push.
+void TestIdleConsumersWakeOnPush() {
+    constexpr int kPushes = 100;
+    SPMCCircularBuffer<steady_clock::time_point> buffer(16);
+    std::atomic<bool> stop = false;
+    std::atomic<int> popped = 0;
+    std::vector<nanoseconds> latencies(kPushes);
+
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 4; ++i) {
+	consumers.emplace_back([&]() {
+	    while (!stop) {
+		if (auto pushed = buffer.TryPopFor(milliseconds(200))) {
+		    auto latency = steady_clock::now() - *pushed;
+		    latencies[popped++] = latency;
+		}
+	    }
+	});
+    }
+
+    std::this_thread::sleep_for(milliseconds(100));
+    auto cpu = bench::CpuTime(RUSAGE_SELF);
+    std::this_thread::sleep_for(milliseconds(1000));
+    CHECK(bench::CpuTime(RUSAGE_SELF) - cpu < milliseconds(20));
+
+    for (int i = 0; i < kPushes; ++i) {
+	buffer.EmplacePush(steady_clock::now());
+	CHECK(test::WaitFor([&]() { return popped == i + 1; }));
+    }
+    stop = true;
+    for (auto& consumer: consumers) {
+	consumer.join();
+    }
+
+    // The median stays clear of preemption noise; an idle machine wakes up within tens of microseconds.
+    std::nth_element(latencies.begin(), latencies.begin() + kPushes / 2, latencies.end());
+    CHECK(latencies[kPushes / 2] < milliseconds(1));
+}
+
+} // namespace
+
+int main() {
+    TestTimesOut();
+    TestIdleConsumersWakeOnPush();
+    return 0;
+}
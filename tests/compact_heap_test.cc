@@ -0,0 +1,93 @@
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "scheduler/compact_heap.h"
+
+using namespace scheduler::internal;
+
+namespace {
+
+using Heap = CompactHeap<int>;
+constexpr int64_t kLead = Heap::kEpochLead;
+
+std::vector<int> PopAll(Heap& heap, int64_t now) {
+    std::vector<int> popped;
+    heap.PopExpired(now, [&](int value) { popped.push_back(value); });
+    return popped;
+}
+
+// Values left behind by an epoch rolling forward still come out in deadline order: the epoch only moves once
+// everything due has been popped.
+void TestRollForwardKeepsOrder() {
+    Heap heap;
+    int64_t first = 4 * kLead;
+    heap.Push(first, 0);
+    // Epoch at 3 * kLead; "now" below is past the middle of the tick range and the new epoch lies beyond all three.
+    heap.Push(first + kLead + 30, 3);
+    heap.Push(first + kLead + 20, 2);
+    heap.Push(first + kLead + 10, 1);
+    heap.Push(first + 8 * kLead, 4);
+
+    auto now = first + 3 * kLead;
+    CHECK((PopAll(heap, now) == std::vector<int>{0, 1, 2, 3}));
+    CHECK(heap.Size() == 1);
+    CHECK(heap.NextDeadline() == first + 8 * kLead);
+    CHECK((PopAll(heap, first + 8 * kLead) == std::vector<int>{4}));
+}
+
+// A deadline behind the epoch moves the epoch back instead of being clamped onto it, so it keeps its place
+// relative to other such deadlines, while the latest deadlines move to the overflow list and stay in order.
+void TestPushBehindEpoch() {
+    Heap heap;
+    int64_t base = 10 * kLead;
+    heap.Push(base, 3);
+    heap.Push(base + 3 * kLead, 4);
+    heap.Push(base - 2 * kLead, 2);
+    heap.Push(base - 3 * kLead, 1);
+    heap.Push(base - 3 * kLead, 10);
+
+    CHECK(heap.NextDeadline() == base - 3 * kLead);
+    CHECK((PopAll(heap, base) == std::vector<int>{1, 10, 2, 3}));
+    CHECK((PopAll(heap, base + 3 * kLead) == std::vector<int>{4}));
+    CHECK(heap.Empty());
+}
+
+// Random deadlines spanning several epochs, polled at increasing times, come out exactly like from an ordered
+// multimap: by deadline, then insertion order.
+void TestMatchesReference() {
+    std::mt19937_64 random(7);
+    std::uniform_int_distribution<int64_t> offset(-kLead, 6 * kLead);
+    Heap heap;
+    std::multimap<int64_t, int> reference;
+    int64_t now = 20 * kLead;
+
+    for (int value = 0; value < 20000; ++value) {
+	auto deadline = now + offset(random);
+	heap.Push(deadline, value);
+	reference.emplace(deadline, value);
+
+	if (value % 100 == 99) {
+	    now += kLead / 4;
+	    std::vector<int> expected;
+	    for (auto it = reference.begin(); it != reference.end() && it->first <= now;) {
+		expected.push_back(it->second);
+		it = reference.erase(it);
+	    }
+	    CHECK(PopAll(heap, now) == expected);
+	    CHECK(heap.Size() == reference.size());
+	}
+    }
+}
+
+} // namespace
+
+int main() {
+    TestRollForwardKeepsOrder();
+    TestPushBehindEpoch();
+    TestMatchesReference();
+    return 0;
+}
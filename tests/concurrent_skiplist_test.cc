@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "scheduler/concurrent_skiplist.h"
+
+using scheduler::internal::ConcurrentSkipList;
+
+namespace {
+
+std::atomic<int64_t> live = 0;
+
+/// A value that counts its live instances, so that leaked or double-freed nodes show up.
+struct Tracked {
+    Tracked() noexcept { ++live; }
+    Tracked(int64_t id, int64_t key) noexcept : id{id}, key{key} { ++live; }
+    Tracked(Tracked&& other) noexcept : id{other.id}, key{other.key} { ++live; }
+    Tracked& operator=(Tracked&& other) noexcept { id = other.id; key = other.key; return *this; }
+    ~Tracked() { --live; }
+
+    int64_t id = -1;
+    int64_t key = 0;
+};
+
+// Producers insert while the consumer pops: every entry comes out once and only once expired, and popped nodes
+// are freed once no producer can still see them.
+void TestConcurrentInsertPop() {
+    constexpr int kProducers = 4;
+    constexpr int64_t kPerProducer = 20000;
+    constexpr int64_t kKeys = 1000;
+
+    {
+	ConcurrentSkipList<Tracked> list;
+	std::atomic<int> done = 0;
+	std::vector<std::thread> producers;
+	for (int p = 0; p < kProducers; ++p) {
+	    producers.emplace_back([&list, &done, p]() {
+		std::mt19937_64 random(p);
+		for (int64_t i = 0; i < kPerProducer; ++i) {
+		    auto key = static_cast<int64_t>(random() % kKeys);
+		    list.Insert(key, Tracked(p * kPerProducer + i, key));
+		}
+		++done;
+	    });
+	}
+
+	std::vector<bool> seen(kProducers * kPerProducer, false);
+	int64_t popped = 0;
+	for (int64_t now = 0; done < kProducers || !list.Empty(); now = (now + 7) % kKeys) {
+	    list.PopExpired(now, [&](Tracked&& value) {
+		CHECK(value.id >= 0 && !seen[value.id]);
+		CHECK(value.key <= now);
+		seen[value.id] = true;
+		++popped;
+	    });
+	}
+	for (auto& producer: producers) {
+	    producer.join();
+	}
+	CHECK(popped == kProducers * kPerProducer);
+
+	// With no producer left, two more epochs free everything retired so far.
+	for (int i = 0; i < 2; ++i) {
+	    list.Insert(0, Tracked(0, 0));
+	    list.PopExpired(0, [](Tracked&&) {});
+	}
+	CHECK(live <= 3);
+    }
+    CHECK(live == 0);
+}
+
+// A single pop hands out entries earliest first, equal deadlines in insertion order.
+void TestOrder() {
+    ConcurrentSkipList<Tracked> list;
+    std::mt19937_64 random(42);
+    size_t expired = 0;
+    for (int64_t i = 0; i < 10000; ++i) {
+	auto key = static_cast<int64_t>(random() % 100);
+	list.Insert(key, Tracked(i, key));
+	expired += key <= 49;
+    }
+    CHECK(list.NextDeadline() == 0);
+
+    std::vector<std::pair<int64_t, int64_t>> order;
+    list.PopExpired(49, [&](Tracked&& value) { order.emplace_back(value.key, value.id); });
+    CHECK(order.size() == expired);
+    CHECK(std::is_sorted(order.begin(), order.end()));
+    CHECK(list.NextDeadline() == 50);
+}
+
+} // namespace
+
+int main() {
+    TestConcurrentInsertPop();
+    TestOrder();
+    CHECK(live == 0);
+    return 0;
+}
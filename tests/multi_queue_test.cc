@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "scheduler/multi_queue.h"
+
+using scheduler::internal::MultiQueue;
+
+namespace {
+
+// Pops one of the smallest entries: the mean rank error stays within a small multiple of the number of heaps.
+void TestRankError(size_t queues) {
+    constexpr int64_t kEntries = 20000;
+    MultiQueue<int64_t> queue(queues);
+
+    std::vector<int64_t> keys(kEntries);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(queues));
+    for (auto key: keys) {
+	queue.Insert(key, key);
+    }
+
+    // The rank of a popped key is the number of smaller keys still queued, counted with a Fenwick tree.
+    std::vector<int64_t> queued(kEntries + 1, 0);
+    auto add = [&](int64_t key, int64_t delta) {
+	for (auto i = key + 1; i <= kEntries; i += i & -i) {
+	    queued[i] += delta;
+	}
+    };
+    auto smaller = [&](int64_t key) {
+	int64_t count = 0;
+	for (auto i = key; i > 0; i -= i & -i) {
+	    count += queued[i];
+	}
+	return count;
+    };
+    for (auto key: keys) {
+	add(key, 1);
+    }
+
+    int64_t total = 0;
+    int64_t popped = 0;
+    for (int64_t value; popped < kEntries;) {
+	// A sample may land on two empty heaps near the end.
+	if (queue.TryPop(kEntries, value)) {
+	    total += smaller(value);
+	    add(value, -1);
+	    ++popped;
+	}
+    }
+    CHECK(queue.Empty());
+    CHECK(queues > 1 || total == 0);
+    CHECK(total / kEntries <= static_cast<int64_t>(2 * queues));
+}
+
+// Every expired entry is popped, however few heaps still hold one; nothing later than `now` is.
+void TestPopExpiredSweeps() {
+    MultiQueue<int64_t> queue(64);
+    for (int64_t key = 0; key < 1000; ++key) {
+	queue.Insert(key, key);
+    }
+
+    std::vector<int64_t> popped;
+    queue.PopExpired(499, [&](int64_t value) { popped.push_back(value); });
+    std::sort(popped.begin(), popped.end());
+    CHECK(popped.size() == 500);
+    CHECK(popped.front() == 0 && popped.back() == 499);
+    CHECK(queue.NextDeadline() == 500);
+
+    popped.clear();
+    queue.PopExpired(999, [&](int64_t value) { popped.push_back(value); });
+    CHECK(popped.size() == 500);
+    CHECK(queue.Empty());
+}
+
+} // namespace
+
+int main() {
+    TestRankError(1);
+    TestRankError(8);
+    TestRankError(64);
+    TestPopExpiredSweeps();
+    return 0;
+}
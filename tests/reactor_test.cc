@@ -0,0 +1,129 @@
+#include <atomic>
+#include <chrono>
+#include <ctime>
+
+#include "check.h"
+#include "scheduler/reactor.h"
+
+using namespace scheduler;
+
+namespace {
+
+std::time_t Now() {
+    return std::time(nullptr);
+}
+
+// An Add from a shard's own task lands in that shard's store and fires on the same thread.
+void TestLocalAdd() {
+    Reactor reactor(4, 16);
+    std::atomic<int> outer = -1;
+    std::atomic<int> inner = -1;
+
+    reactor.Run();
+    reactor.AddOn(2, [&] {
+	outer = static_cast<int>(*reactor.CurrentShard());
+	reactor.Add([&] { inner = static_cast<int>(*reactor.CurrentShard()); }, Now());
+    }, Now());
+    reactor.Shutdown();
+
+    CHECK(outer == 2);
+    CHECK(inner == 2);
+}
+
+// AddOn from one shard to another fires on the destination shard.
+void TestCrossShardAdd() {
+    Reactor reactor(2, 16);
+    std::atomic<int> fired_on = -1;
+
+    reactor.Run();
+    reactor.AddOn(0, [&] {
+	reactor.AddOn(1, [&] { fired_on = static_cast<int>(*reactor.CurrentShard()); }, Now());
+    }, Now());
+    reactor.Shutdown();
+
+    CHECK(fired_on == 1);
+}
+
+// Sending more timers than the inter-shard ring holds parks them in the sender's overflow without losing any.
+void TestFullRing() {
+    constexpr int kTimers = 1000;
+    Reactor reactor(2, 2);
+    std::atomic<int> fired = 0;
+    std::atomic<bool> wrong_shard = false;
+
+    reactor.Run();
+    reactor.AddOn(0, [&] {
+	for (int i = 0; i < kTimers; ++i) {
+	    reactor.AddOn(1, [&] {
+		wrong_shard = wrong_shard || reactor.CurrentShard() != 1;
+		++fired;
+	    }, Now());
+	}
+    }, Now());
+    reactor.Shutdown();
+
+    CHECK(fired == kTimers);
+    CHECK(!wrong_shard);
+}
+
+// A foreign thread adding to a busy shard whose ring is full neither blocks nor loses timers.
+void TestForeignAdd() {
+    constexpr int kTimers = 1000;
+    Reactor reactor(1, 2);
+    std::atomic<bool> started = false;
+    std::atomic<bool> release = false;
+    std::atomic<int> fired = 0;
+
+    CHECK(!reactor.CurrentShard());
+    reactor.Run();
+    reactor.Add([&] {
+	started = true;
+	CHECK(test::WaitFor([&] { return release.load(); }));
+    }, Now());
+    CHECK(test::WaitFor([&] { return started.load(); }));
+
+    for (int i = 0; i < kTimers; ++i) {
+	reactor.Add([&] { ++fired; }, Now());
+    }
+    release = true;
+    reactor.Shutdown();
+
+    CHECK(fired == kTimers);
+}
+
+// Shutdown returns only once every timer has fired, including those added by the timers themselves, and
+// the reactor can be run again afterwards.
+void TestShutdownQuiescence() {
+    Reactor reactor(2, 4);
+    std::atomic<int> fired = 0;
+
+    for (int round = 0; round < 2; ++round) {
+	fired = 0;
+	reactor.Run();
+	reactor.Add([&] {
+	    ++fired;
+	    reactor.AddOn(1, [&] {
+		++fired;
+		reactor.Add([&] { ++fired; }, Now() + 1);
+	    }, Now());
+	}, Now());
+
+	auto start = std::chrono::steady_clock::now();
+	reactor.Shutdown();
+	auto took = std::chrono::steady_clock::now() - start;
+
+	CHECK(fired == 3);
+	CHECK(took < std::chrono::seconds(3));
+    }
+}
+
+} // namespace
+
+int main() {
+    TestLocalAdd();
+    TestCrossShardAdd();
+    TestFullRing();
+    TestForeignAdd();
+    TestShutdownQuiescence();
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#include "check.h"
+#include "scheduler/record_buffer.h"
+
+using namespace scheduler::internal;
+
+namespace {
+
+/// Mirrors the ring's record header, whose size is the ring's cell size.
+struct alignas(std::max_align_t) HeaderLayout {
+    size_t size;
+    void (*invoke)(void*);
+    void (*destroy)(void*);
+    std::atomic<bool> consumed;
+};
+
+constexpr size_t kCell = sizeof(HeaderLayout);
+
+template<size_t Cells>
+auto RecordOfCells(std::atomic<size_t>& runs) {
+    // One cell holds the header, the rest the payload.
+    return [&runs, pad = std::array<std::byte, (Cells - 1) * kCell - sizeof(void*)>{}]() {
+	(void)pad;
+	++runs;
+    };
+}
+
+// A record that does not fit into the tail must not wait for room for padding and record together:
+// with a 40-cell ring, 20 cells used and released, a 23-cell record needs 20 cells of padding first.
+void TestWrapLargerThanHalf() {
+    SPMCRecordBuffer<> buffer(40 * kCell);
+    std::atomic<size_t> runs = 0;
+
+    for (int i = 0; i < 10; ++i) {
+	buffer.Push(RecordOfCells<2>(runs));
+    }
+    while (buffer.TryConsume()) {
+    }
+    CHECK(runs == 10);
+
+    std::atomic<bool> stop = false;
+    std::thread consumer([&]() {
+	while (!stop) {
+	    buffer.TryConsumeFor(std::chrono::milliseconds(1));
+	}
+    });
+
+    std::atomic<bool> pushed = false;
+    std::thread producer([&]() {
+	buffer.Push(RecordOfCells<23>(runs));
+	buffer.Push(RecordOfCells<23>(runs));
+	pushed = true;
+    });
+
+    CHECK(test::WaitFor([&]() { return pushed && runs == 12; }));
+    stop = true;
+    producer.join();
+    consumer.join();
+}
+
+// Records of every size keep wrapping around without losing or duplicating any.
+void TestManyWraps() {
+    SPMCRecordBuffer<> buffer(16 * kCell);
+    std::atomic<size_t> runs = 0;
+    std::atomic<bool> stop = false;
+
+    std::thread consumer([&]() {
+	while (!stop || !buffer.Empty()) {
+	    buffer.TryConsumeFor(std::chrono::milliseconds(1));
+	}
+    });
+
+    for (int i = 0; i < 1000; ++i) {
+	switch (i % 4) {
+	    case 0: buffer.Push(RecordOfCells<2>(runs)); break;
+	    case 1: buffer.Push(RecordOfCells<9>(runs)); break;
+	    case 2: buffer.Push(RecordOfCells<16>(runs)); break;
+	    default: buffer.Push(RecordOfCells<5>(runs)); break;
+	}
+    }
+
+    stop = true;
+    consumer.join();
+    CHECK(runs == 1000);
+}
+
+// A batch may span the padding at the end of the ring: padding is skipped without being counted, the batch is
+// split wherever the limit falls, and every cell, padding included, is released for reuse afterwards.
+void TestBatchAcrossPadding() {
+    SPMCRecordBuffer<> buffer(16 * kCell);
+    std::atomic<size_t> runs = 0;
+
+    // Moves the ring's position to cell 11, so that the third 2-cell record below needs one cell of padding.
+    buffer.Push(RecordOfCells<5>(runs));
+    buffer.Push(RecordOfCells<6>(runs));
+    CHECK(buffer.TryConsumeBatch(2) == 2);
+
+    for (int i = 0; i < 4; ++i) {
+	buffer.Push(RecordOfCells<2>(runs));
+    }
+    CHECK(buffer.TryConsumeBatch(3) == 3);
+    CHECK(buffer.TryConsumeBatch(8) == 1);
+    CHECK(buffer.TryConsumeBatch(8) == 0);
+    CHECK(buffer.Empty());
+    CHECK(runs == 6);
+
+    // Only fits if the batches released everything, including the padding.
+    for (int i = 0; i < 8; ++i) {
+	buffer.Push(RecordOfCells<2>(runs));
+    }
+    CHECK(buffer.TryConsumeBatch(8) == 8);
+    CHECK(runs == 14);
+}
+
+// A callable larger than the ring is boxed instead of blocking forever.
+void TestOversized() {
+    SPMCRecordBuffer<> buffer(4 * kCell);
+    std::atomic<size_t> runs = 0;
+    buffer.Push(RecordOfCells<8>(runs));
+    CHECK(buffer.TryConsume());
+    CHECK(runs == 1);
+}
+
+} // namespace
+
+int main() {
+    TestWrapLargerThanHalf();
+    TestManyWraps();
+    TestBatchAcrossPadding();
+    TestOversized();
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include <unistd.h>
+
+#include "check.h"
+#include "scheduler/scheduler.h"
+
+using namespace scheduler;
+
+namespace {
+
+// Tasks added to a concurrent store survive switching to another backend, and Shutdown still returns.
+void TestSwitchAwayFromConcurrentStore(TimerBackend from, TimerBackend to) {
+    Scheduler scheduler(16, 2);
+    std::atomic<int> runs = 0;
+
+    scheduler.SetTimerBackend(from);
+    for (int i = 0; i < 10; ++i) {
+	scheduler.Add([&runs]() { ++runs; }, std::time(nullptr) + i % 2);
+    }
+    scheduler.SetTimerBackend(to);
+
+    scheduler.Run();
+    scheduler.Shutdown();
+    CHECK(runs == 10);
+}
+
+// Workers adding follow-ups too far ahead to keep locally all go through the ingest ring at once without losing any.
+void TestConcurrentAddsFromWorkers() {
+    constexpr int kTasks = 8;
+    constexpr int kFollowUps = 500;
+    Scheduler scheduler(16, 4);
+    std::atomic<int> runs = 0;
+
+    scheduler.SetTimerBackend(TimerBackend::RadixHeap);
+    scheduler.Run();
+    auto later = std::time(nullptr) + 2;
+    for (int i = 0; i < kTasks; ++i) {
+	scheduler.Add([&]() {
+	    for (int j = 0; j < kFollowUps; ++j) {
+		scheduler.Add([&runs]() { ++runs; }, later);
+	    }
+	}, std::time(nullptr));
+    }
+
+    CHECK(test::WaitFor([&]() { return runs == kTasks * kFollowUps; }));
+    scheduler.Shutdown();
+}
+
+// A blocking task runs on the blocking pool: a regular task due at the same time is not held up behind it,
+// and each pool's metrics count only its own tasks.
+void TestBlockingTaskDoesNotDelayRegular() {
+    Scheduler scheduler(16, 1);
+    std::atomic<bool> blocked = false;
+    std::atomic<bool> release = false;
+    std::atomic<bool> regular = false;
+
+    auto now = std::time(nullptr);
+    scheduler.Add([&]() {
+	blocked = true;
+	CHECK(test::WaitFor([&]() { return release.load(); }));
+    }, now, TaskKind::Blocking);
+    scheduler.Add([&]() { regular = true; }, now);
+    scheduler.Run();
+
+    CHECK(test::WaitFor([&]() { return blocked && regular; }));
+    release = true;
+    scheduler.Shutdown();
+
+    auto blocking = scheduler.Metrics(TaskKind::Blocking);
+    CHECK(blocking.submitted == 1);
+    CHECK(blocking.completed == 1);
+    auto normal = scheduler.Metrics();
+    CHECK(normal.submitted == 1);
+    CHECK(normal.completed == 1);
+}
+
+// A task handed over early to a shared executor still runs after the scheduler that dispatched it is gone.
+void TestEarlyHandoffOutlivesScheduler() {
+    auto pool = std::make_shared<internal::ThreadPool>(1, 16);
+    std::atomic<bool> release = false;
+    std::atomic<int> runs = 0;
+    pool->Run();
+
+    auto scheduler = std::make_unique<Scheduler>(16, pool);
+    // Handed over within a second of being added, at whatever point of the second the test starts.
+    scheduler->SetEarlyHandoff(std::chrono::microseconds(1'500'000));
+    scheduler->Add([&]() {
+	while (!release) {
+	    std::this_thread::yield();
+	}
+    }, std::time(nullptr));
+    scheduler->Add([&runs]() { ++runs; }, std::time(nullptr) + 2);
+    scheduler->Run();
+    scheduler.reset();
+
+    release = true;
+    CHECK(test::WaitFor([&]() { return runs == 1; }));
+    pool->Shutdown();
+}
+
+// A deserialized task still reaches its handler after the scheduler that dispatched it is gone.
+void TestSerializedOutlivesScheduler() {
+    auto pool = std::make_shared<internal::ThreadPool>(1, 16);
+    std::atomic<bool> release = false;
+    std::atomic<int> runs = 0;
+    pool->Run();
+
+    auto scheduler = std::make_unique<Scheduler>(16, pool);
+    auto handler = scheduler->RegisterSpillHandler([&runs](std::string_view payload) { runs += payload == "42"; });
+    scheduler->Add([&]() {
+	while (!release) {
+	    std::this_thread::yield();
+	}
+    }, std::time(nullptr));
+    scheduler->AddSerialized(handler, "42", std::time(nullptr));
+    scheduler->Run();
+    scheduler.reset();
+
+    release = true;
+    CHECK(test::WaitFor([&]() { return runs == 1; }));
+    pool->Shutdown();
+}
+
+// Tasks routed to two named executors run on disjoint sets of threads, and each executor counts only its own.
+void TestNamedExecutorsAreIsolated() {
+    constexpr size_t kTasks = 50;
+    Scheduler scheduler(16, 1);
+    auto io = scheduler.AddExecutor("io", 2, 16);
+    auto cpu = scheduler.AddExecutor("cpu", 2, 16);
+    CHECK(scheduler.FindExecutor("io") == io);
+    CHECK(scheduler.FindExecutor("cpu") == cpu);
+
+    std::mutex mutex;
+    std::set<std::thread::id> io_threads;
+    std::set<std::thread::id> cpu_threads;
+    auto record = [&mutex](std::set<std::thread::id>& threads) {
+	std::lock_guard lock(mutex);
+	threads.insert(std::this_thread::get_id());
+    };
+
+    scheduler.Run();
+    auto now = std::time(nullptr);
+    for (size_t i = 0; i < kTasks; ++i) {
+	scheduler.Add([&]() { record(io_threads); }, now, io);
+	scheduler.Add([&]() { record(cpu_threads); }, now, cpu);
+    }
+    scheduler.Shutdown();
+
+    CHECK(!io_threads.empty() && io_threads.size() <= 2);
+    CHECK(!cpu_threads.empty() && cpu_threads.size() <= 2);
+    for (auto& id: io_threads) {
+	CHECK(!cpu_threads.count(id));
+    }
+    CHECK(scheduler.Metrics(io).submitted == kTasks);
+    CHECK(scheduler.Metrics(io).completed == kTasks);
+    CHECK(scheduler.Metrics(cpu).submitted == kTasks);
+    CHECK(scheduler.Metrics(cpu).completed == kTasks);
+    CHECK(scheduler.Metrics().submitted == 0);
+}
+
+// An unknown executor id is rejected by Add itself instead of being dispatched into out of bounds.
+void TestUnknownExecutor() {
+    Scheduler scheduler(16, 1);
+    scheduler.Run();
+
+    bool thrown = false;
+    try {
+	scheduler.Add([]() {}, std::time(nullptr), ExecutorId(7));
+    } catch (const std::out_of_range&) {
+	thrown = true;
+    }
+    CHECK(thrown);
+    scheduler.Shutdown();
+}
+
+// An unknown spill handler is rejected by AddSerialized itself, also for a task bound for the disk tier.
+void TestUnknownSpillHandler() {
+    char directory[] = "/tmp/scheduler-test-XXXXXX";
+    CHECK(::mkdtemp(directory));
+
+    Scheduler scheduler(16, 1);
+    scheduler.EnableSpill(directory, 60);
+    auto handler = scheduler.RegisterSpillHandler([](std::string_view) {});
+    scheduler.Run();
+
+    for (auto timestamp: { std::time(nullptr), std::time(nullptr) + 3600 }) {
+	bool thrown = false;
+	try {
+	    scheduler.AddSerialized(handler + 1, "", timestamp);
+	} catch (const std::out_of_range&) {
+	    thrown = true;
+	}
+	CHECK(thrown);
+    }
+    scheduler.Shutdown();
+    ::rmdir(directory);
+}
+
+} // namespace
+
+int main() {
+    TestSwitchAwayFromConcurrentStore(TimerBackend::SkipList, TimerBackend::Adaptive);
+    TestSwitchAwayFromConcurrentStore(TimerBackend::MultiQueue, TimerBackend::RadixHeap);
+    TestSwitchAwayFromConcurrentStore(TimerBackend::SkipList, TimerBackend::MultiQueue);
+    TestSwitchAwayFromConcurrentStore(TimerBackend::MultiQueue, TimerBackend::SkipList);
+    TestConcurrentAddsFromWorkers();
+    TestBlockingTaskDoesNotDelayRegular();
+    TestEarlyHandoffOutlivesScheduler();
+    TestSerializedOutlivesScheduler();
+    TestNamedExecutorsAreIsolated();
+    TestUnknownExecutor();
+    TestUnknownSpillHandler();
+    return 0;
+}
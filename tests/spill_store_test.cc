@@ -0,0 +1,65 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "check.h"
+#include "scheduler/spill_store.h"
+
+using namespace scheduler::internal;
+
+namespace {
+
+std::vector<int64_t> RefillAll(SpillStore& store, int64_t until) {
+    std::vector<int64_t> deadlines;
+    store.Refill(until, [&](int64_t deadline, uint32_t handler, std::string_view payload) {
+	CHECK(handler == 7);
+	CHECK(payload == std::to_string(deadline));
+	deadlines.push_back(deadline);
+    });
+    return deadlines;
+}
+
+// Tasks written out as runs come back within the window they fall into, each run in deadline order.
+void TestRoundTrip() {
+    char directory[] = "/tmp/spill-test-XXXXXX";
+    CHECK(::mkdtemp(directory));
+    SpillStore store(directory, 256);
+
+    for (int64_t deadline = 1000; deadline > 0; deadline -= 3) {
+	store.Add(deadline, 7, std::to_string(deadline));
+    }
+    CHECK(!store.Error());
+
+    auto first = RefillAll(store, 500);
+    CHECK(!first.empty());
+    for (auto deadline: first) {
+	CHECK(deadline < 500);
+    }
+    auto second = RefillAll(store, 1001);
+    CHECK(first.size() + second.size() == 334);
+    CHECK(store.Empty());
+    ::rmdir(directory);
+}
+
+// A failing disk is reported, and every task stays in memory.
+void TestFlushFailure() {
+    SpillStore store("/nonexistent/spill-test", 64);
+
+    for (int64_t deadline = 0; deadline < 10000; ++deadline) {
+	store.Add(deadline, 7, std::to_string(deadline));
+    }
+    CHECK(store.Error() == std::errc::no_such_file_or_directory);
+    CHECK(store.Size() == 10000);
+    CHECK(RefillAll(store, 10000).size() == 10000);
+}
+
+} // namespace
+
+int main() {
+    TestRoundTrip();
+    TestFlushFailure();
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "scheduler/threadpool.h"
+
+using namespace scheduler;
+using namespace std::chrono;
+
+namespace {
+
+// Due continuations run newest first, right after the task that added them and on the same worker.
+void TestLocalQueueIsLifo() {
+    ThreadPool pool(2, 16);
+    std::vector<int> order;
+    std::thread::id parent;
+    std::atomic<bool> same_thread = true;
+
+    pool.Run();
+    pool.AddTask([&] {
+	parent = std::this_thread::get_id();
+	for (int i = 1; i <= 3; ++i) {
+	    pool.AddLocal([&, i] {
+		same_thread = same_thread && std::this_thread::get_id() == parent;
+		order.push_back(i);
+	    }, system_clock::now());
+	}
+    });
+    pool.Shutdown();
+
+    CHECK((order == std::vector<int>{3, 2, 1}));
+    CHECK(same_thread);
+}
+
+// A continuation that is not due yet waits in the worker's timer heap and fires on that worker once due.
+void TestLocalTimer() {
+    ThreadPool pool(2, 16);
+    std::thread::id parent;
+    std::thread::id fired_on;
+    system_clock::time_point when;
+    std::atomic<bool> fired = false;
+    bool early = true;
+
+    pool.Run();
+    pool.AddTask([&] {
+	parent = std::this_thread::get_id();
+	when = system_clock::now() + milliseconds(50);
+	pool.AddLocal([&] {
+	    early = system_clock::now() < when;
+	    fired_on = std::this_thread::get_id();
+	    fired = true;
+	}, when);
+    });
+
+    CHECK(test::WaitFor([&] { return fired.load(); }));
+    pool.Shutdown();
+
+    CHECK(!early);
+    CHECK(fired_on == parent);
+}
+
+// Shutdown waits for local work, both due continuations and pending local timers, before joining the worker.
+void TestShutdownDrainsLocalWork() {
+    ThreadPool pool(1, 16);
+    std::atomic<bool> started = false;
+    std::atomic<int> executed = 0;
+
+    pool.Run();
+    pool.AddTask([&] {
+	for (int i = 0; i < 100; ++i) {
+	    pool.AddLocal([&] { ++executed; }, system_clock::now());
+	}
+	pool.AddLocal([&] { ++executed; }, system_clock::now() + milliseconds(100));
+	started = true;
+    });
+
+    CHECK(test::WaitFor([&] { return started.load(); }));
+    pool.Shutdown();
+
+    CHECK(executed == 101);
+    CHECK(pool.Metrics().completed == pool.Metrics().submitted);
+}
+
+// A `Fn` added while workers are parked goes straight into a parked worker's mailbox, never through the ring,
+// and each one unparks a worker of its own: the first task only returns once the second has run beside it.
+void TestHandOffToParkedWorkers() {
+    ThreadPool pool(2, 16);
+    std::atomic<bool> second = false;
+    std::atomic<bool> first = false;
+
+    pool.Run();
+    // Gives both workers time to find the ring empty and park.
+    std::this_thread::sleep_for(milliseconds(100));
+
+    pool.AddTask(ThreadPool::Fn([&] {
+	CHECK(test::WaitFor([&] { return second.load(); }));
+	first = true;
+    }));
+    CHECK(pool.Metrics().queued == 0);
+    pool.AddTask(ThreadPool::Fn([&] { second = true; }));
+    CHECK(pool.Metrics().queued == 0);
+
+    CHECK(test::WaitFor([&] { return first.load(); }));
+    pool.Shutdown();
+}
+
+// A task deposited into a mailbox right before Shutdown still runs before Shutdown returns.
+void TestShutdownRunsMailbox() {
+    ThreadPool pool(1, 16);
+    std::atomic<int> runs = 0;
+
+    for (int round = 0; round < 20; ++round) {
+	pool.Run();
+	std::this_thread::sleep_for(milliseconds(10));
+	pool.AddTask(ThreadPool::Fn([&] { ++runs; }));
+	pool.Shutdown();
+	CHECK(runs == round + 1);
+    }
+    CHECK(pool.Metrics().completed == pool.Metrics().submitted);
+}
+
+} // namespace
+
+int main() {
+    TestLocalQueueIsLifo();
+    TestLocalTimer();
+    TestShutdownDrainsLocalWork();
+    TestHandOffToParkedWorkers();
+    TestShutdownRunsMailbox();
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "scheduler/scheduler.h"
+
+using namespace scheduler;
+using namespace scheduler::internal;
+
+std::atomic<size_t> allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (auto* memory = std::malloc(size ? size : 1)) {
+	return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+std::atomic<int> fired = 0;
+
+struct Counted : TimerHook {
+    Counted() : TimerHook([](TimerHook&) { ++fired; }) {}
+};
+
+// Hooks expire in deadline order through any mix of re-arming and disarming, and only the expired ones are touched.
+void TestOrder() {
+    std::mt19937 random(42);
+    std::vector<Counted> hooks(1000);
+    std::vector<std::time_t> deadlines(hooks.size(), -1);
+    TimerHookList list;
+
+    for (int round = 0; round < 5000; ++round) {
+	auto i = random() % hooks.size();
+	if (random() % 4 == 0) {
+	    CHECK(list.Unlink(hooks[i]) == (deadlines[i] >= 0));
+	    deadlines[i] = -1;
+	} else {
+	    deadlines[i] = random() % 10000;
+	    list.Link(hooks[i], deadlines[i]);
+	}
+    }
+
+    std::vector<std::time_t> expected;
+    for (auto deadline: deadlines) {
+	if (deadline >= 0) {
+	    expected.push_back(deadline);
+	}
+    }
+    std::sort(expected.begin(), expected.end());
+    CHECK(list.NextDeadline() == expected.front());
+
+    std::vector<std::time_t> expired;
+    list.Expire(5000, [&](TimerHook& hook, uint32_t fire) {
+	CHECK(list.Claim(fire) == &hook);
+	expired.push_back(hook.Deadline());
+    });
+    list.Expire(10000, [&](TimerHook& hook, uint32_t fire) {
+	CHECK(list.Claim(fire) == &hook);
+	expired.push_back(hook.Deadline());
+    });
+    CHECK(expired == expected);
+    CHECK(list.Empty());
+}
+
+// A queued invocation is cancelled by disarming or re-arming the hook before it claims the hook.
+void TestCancelQueued() {
+    TimerHookList list;
+    Counted first, second;
+    std::vector<uint32_t> queued;
+    auto queue = [&](TimerHook&, uint32_t fire) { queued.push_back(fire); };
+
+    list.Link(first, 1);
+    list.Link(second, 1);
+    list.Expire(1, queue);
+    CHECK(queued.size() == 2);
+
+    CHECK(list.Unlink(first));
+    CHECK(!list.Unlink(first));
+    CHECK(list.Link(second, 5));
+
+    for (auto fire: queued) {
+	CHECK(!list.Claim(fire));
+    }
+    CHECK(list.Queued() == 0);
+    CHECK(list.NextDeadline() == 5);
+}
+
+// Once the fire slots have grown to the peak of queued invocations, expiring hooks, cancelling their queued
+// invocations and claiming them allocates nothing.
+void TestNoAllocationOnceWarm() {
+    TimerHookList list;
+    std::vector<Counted> hooks(64);
+    std::vector<std::pair<TimerHook*, uint32_t>> queued;
+    queued.reserve(hooks.size());
+    auto queue = [&](TimerHook& hook, uint32_t fire) { queued.emplace_back(&hook, fire); };
+
+    for (std::time_t round = 0; round < 3; ++round) {
+	auto before = allocations.load();
+	for (auto& hook: hooks) {
+	    list.Link(hook, round);
+	}
+	list.Expire(round, queue);
+	for (size_t i = 0; i < hooks.size(); i += 2) {
+	    CHECK(list.Unlink(hooks[i]));
+	}
+	for (auto [hook, fire]: queued) {
+	    bool cancelled = (static_cast<Counted*>(hook) - hooks.data()) % 2 == 0;
+	    CHECK(list.Claim(fire) == (cancelled ? nullptr : hook));
+	}
+	queued.clear();
+
+	CHECK(list.Queued() == 0);
+	CHECK(round == 0 || allocations == before);
+    }
+}
+
+// A hook disarmed while its callback waits for a busy worker may be destroyed right away.
+void TestDisarmInFlight() {
+    Scheduler scheduler(16, 1);
+    std::atomic<bool> started = false;
+    std::atomic<bool> release = false;
+    auto hook = std::make_unique<Counted>();
+
+    scheduler.Run();
+    scheduler.Add([&]() {
+	started = true;
+	while (!release) {
+	    std::this_thread::yield();
+	}
+    }, std::time(nullptr));
+    CHECK(test::WaitFor([&]() { return started.load(); }));
+    scheduler.Arm(*hook, std::time(nullptr) - 1);
+
+    CHECK(test::WaitFor([&]() { return scheduler.Metrics().submitted == 2; }));
+    CHECK(scheduler.Disarm(*hook));
+    hook.reset();
+
+    release = true;
+    scheduler.Shutdown();
+    CHECK(scheduler.Metrics().completed == 2);
+    CHECK(fired == 0);
+}
+
+} // namespace
+
+int main() {
+    TestOrder();
+    TestCancelQueued();
+    TestNoAllocationOnceWarm();
+    TestDisarmInFlight();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "check.h"
+#include "scheduler/scheduler.h"
+
+using namespace scheduler;
+using namespace std::chrono;
+
+namespace {
+
+/// Lateness tolerated on a loaded single-core machine.
+constexpr auto kMaxLateness = milliseconds(200);
+
+/// CPU time the whole process may spend per second of mostly idle waiting.
+constexpr auto kMaxIdleCpu = milliseconds(100);
+
+struct Far : TimerHook {
+    Far() : TimerHook([](TimerHook&) {}) {}
+};
+
+// One sleeping service thread drives several schedulers: tasks added while it sleeps for a far deadline ring
+// the doorbell, every task runs on time, and the service costs next to no CPU in between.
+void TestSeveralSchedulers() {
+    constexpr int kSchedulers = 4;
+    TimerService service;
+    auto pool = std::make_shared<ThreadPool>(2, 64);
+    pool->Run();
+
+    std::vector<std::unique_ptr<Scheduler>> schedulers;
+    Far far;
+    for (int i = 0; i < kSchedulers; ++i) {
+	schedulers.push_back(std::make_unique<Scheduler>(16, pool, service));
+	CHECK(!schedulers.back()->SetWakeMode(WakeMode::TimerFd));
+	schedulers.back()->Run();
+    }
+    schedulers[0]->Arm(far, std::time(nullptr) + 3600);
+    CHECK(service.Size() == kSchedulers);
+    std::this_thread::sleep_for(milliseconds(100));
+
+    std::atomic<int> runs = 0;
+    std::atomic<int64_t> worst = 0;
+    auto cpu = bench::CpuTime();
+    auto wall = steady_clock::now();
+    auto now = std::time(nullptr);
+    for (int i = 0; i < kSchedulers; ++i) {
+	for (auto deadline: { now + 1, now + 2 }) {
+	    schedulers[i]->Add([&, deadline]() {
+		auto late = duration_cast<nanoseconds>(system_clock::now() - system_clock::from_time_t(deadline)).count();
+		for (auto seen = worst.load(); late > seen && !worst.compare_exchange_weak(seen, late);) {
+		}
+		++runs;
+	    }, deadline);
+	}
+    }
+
+    CHECK(test::WaitFor([&]() { return runs == 2 * kSchedulers; }));
+    CHECK(nanoseconds(worst.load()) < kMaxLateness);
+    auto elapsed = duration_cast<seconds>(steady_clock::now() - wall) + seconds(1);
+    CHECK(bench::CpuTime() - cpu < kMaxIdleCpu * elapsed.count());
+
+    CHECK(schedulers[0]->Disarm(far));
+    for (auto& scheduler: schedulers) {
+	scheduler->Shutdown();
+    }
+    CHECK(service.Size() == 0);
+    pool->Shutdown();
+}
+
+// Shutdown waits for the scheduler's pending tasks before unregistering it, while the other schedulers
+// stay registered and keep being driven; a scheduler can register again after it was shut down.
+void TestShutdownDrains() {
+    TimerService service;
+    Scheduler first(16, 1, service);
+    Scheduler second(16, 1, service);
+    first.Run();
+    second.Run();
+
+    std::atomic<int> runs = 0;
+    first.Add([&runs]() { ++runs; }, std::time(nullptr) + 1);
+    first.Shutdown();
+    CHECK(runs == 1);
+    CHECK(service.Size() == 1);
+
+    second.Add([&runs]() { ++runs; }, std::time(nullptr) + 1);
+    CHECK(test::WaitFor([&]() { return runs == 2; }));
+
+    first.Run();
+    first.Add([&runs]() { ++runs; }, std::time(nullptr));
+    CHECK(test::WaitFor([&]() { return runs == 3; }));
+    first.Shutdown();
+    second.Shutdown();
+    CHECK(service.Size() == 0);
+}
+
+} // namespace
+
+int main() {
+    TestSeveralSchedulers();
+    TestShutdownDrains();
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <cstdint>
+
+#include "check.h"
+#include "scheduler/timer_store.h"
+
+using namespace scheduler;
+using namespace scheduler::internal;
+
+namespace {
+
+constexpr int64_t kNow = 1'000'000;
+
+// A set beyond the large-set threshold goes to the compact heap only once it is renewed slowly: right after a burst
+// of inserts the radix heap is kept, and the switch happens at the first evaluation without any.
+void TestPicksCompactForLargeSlowSets() {
+    using Store = TimerStore<int>;
+    Store store;
+    // Starts out in the radix heap rather than migrating there from the array first.
+    store.SetBackend(TimerBackend::RadixHeap);
+    store.SetBackend(TimerBackend::Adaptive);
+    for (size_t i = 0; i < Store::kLargeSet + 1; ++i) {
+	store.Push(kNow + Store::kWideSpread - static_cast<int64_t>(i % 3600), 0);
+    }
+
+    store.PopExpired(kNow, [](int) {});
+    CHECK(store.Backend() == TimerBackend::RadixHeap);
+    CHECK(store.Metrics().large_set_threshold == Store::kLargeSet);
+
+    store.PopExpired(kNow + 1, [](int) {});
+    CHECK(store.Backend() == TimerBackend::Compact);
+    for (int64_t second = 2; store.Metrics().migrating; ++second) {
+	store.PopExpired(kNow + second, [](int) {});
+    }
+    CHECK(store.Metrics().insert_rate == 0);
+    CHECK(store.Size() == Store::kLargeSet + 1);
+}
+
+// A pinned store never switches, but its metrics are still refreshed once per evaluation period.
+void TestPinnedMetricsStayFresh() {
+    TimerStore<int> store;
+    store.SetBackend(TimerBackend::Ladder);
+    CHECK(store.Metrics().pending == 0);
+
+    for (int i = 0; i < 5000; ++i) {
+	store.Push(kNow + 10 + i % 100, i);
+    }
+    store.PopExpired(kNow, [](int) {});
+
+    auto metrics = store.Metrics();
+    CHECK(metrics.backend == TimerBackend::Ladder);
+    CHECK(!metrics.adaptive);
+    CHECK(metrics.pending == 5000);
+    CHECK(metrics.insert_rate == 5000);
+
+    store.PopExpired(kNow + 1, [](int) {});
+    CHECK(store.Metrics().insert_rate == 0);
+    CHECK(store.Backend() == TimerBackend::Ladder);
+}
+
+} // namespace
+
+int main() {
+    TestPicksCompactForLargeSlowSets();
+    TestPinnedMetricsStayFresh();
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <string_view>
+#include <thread>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "check.h"
+#include "scheduler/scheduler.h"
+
+using namespace scheduler;
+using namespace std::chrono;
+
+namespace {
+
+/// Lateness tolerated on a loaded single-core machine; on time is within microseconds when idle.
+constexpr auto kMaxLateness = milliseconds(200);
+
+/// CPU time the whole process may spend per second of mostly idle waiting.
+constexpr auto kMaxIdleCpu = milliseconds(100);
+
+struct Probe : TimerHook {
+    Probe() : TimerHook([](TimerHook& hook) { static_cast<Probe&>(hook).Record(hook.Deadline()); }) {}
+
+    void Record(std::time_t deadline) {
+	lateness = system_clock::now() - system_clock::from_time_t(deadline);
+	ran = true;
+    }
+
+    std::atomic<bool> ran = false;
+    nanoseconds lateness {};
+};
+
+// A loop sleeping for a far deadline wakes up on time for whatever is added meanwhile: a task, a hook,
+// and a spilled task to be read back, without burning CPU in between.
+void TestWakesForLaterAdditions(WakeMode mode) {
+    char directory[] = "/tmp/wake-test-XXXXXX";
+    CHECK(::mkdtemp(directory));
+
+    Scheduler scheduler(16, 1);
+    CHECK(scheduler.SetWakeMode(mode));
+    scheduler.EnableSpill(directory, 1);
+    auto handler = scheduler.RegisterSpillHandler([](std::string_view) {});
+
+    Probe far, hook, task, spilled;
+    scheduler.Arm(far, std::time(nullptr) + 3600);
+
+    std::atomic<bool> stop = false;
+    std::thread external;
+    if (mode == WakeMode::External) {
+	external = std::thread([&]() {
+	    int epoll = ::epoll_create1(0);
+	    epoll_event event { .events = EPOLLIN, .data = { .fd = scheduler.Fd() } };
+	    ::epoll_ctl(epoll, EPOLL_CTL_ADD, scheduler.Fd(), &event);
+	    while (!stop) {
+		if (::epoll_wait(epoll, &event, 1, 10) > 0) {
+		    scheduler.ProcessEvents();
+		}
+	    }
+	    ::close(epoll);
+	});
+    }
+    scheduler.Run();
+    std::this_thread::sleep_for(milliseconds(100));
+
+    auto cpu = bench::CpuTime();
+    auto wall = steady_clock::now();
+    auto now = std::time(nullptr);
+    scheduler.Arm(hook, now + 1);
+    auto deadline = now + 2;
+    scheduler.Add([&task, deadline]() { task.Record(deadline); }, deadline);
+    scheduler.AddSerialized(handler, "", now + 3);
+    scheduler.Arm(spilled, now + 3);
+
+    CHECK(test::WaitFor([&]() { return hook.ran && task.ran && spilled.ran; }));
+    CHECK(hook.lateness < kMaxLateness);
+    CHECK(task.lateness < kMaxLateness);
+    CHECK(spilled.lateness < kMaxLateness);
+
+    auto elapsed = duration_cast<seconds>(steady_clock::now() - wall) + seconds(1);
+    CHECK(bench::CpuTime() - cpu < kMaxIdleCpu * elapsed.count());
+
+    CHECK(scheduler.Disarm(far));
+    if (mode == WakeMode::External) {
+	stop = true;
+	external.join();
+    }
+    scheduler.Shutdown();
+    ::rmdir(directory);
+}
+
+// In External mode, the application's loop thread can add more tasks than the ring holds without deadlocking
+// on it, and calling ProcessEvents in any other mode does nothing.
+void TestExternalFullRing() {
+    constexpr int kTasks = 100;
+    Scheduler scheduler(4, 1);
+    CHECK(scheduler.SetWakeMode(WakeMode::External));
+    std::atomic<int> runs = 0;
+
+    scheduler.Run();
+    auto now = std::time(nullptr);
+    for (int i = 0; i < kTasks; ++i) {
+	scheduler.Add([&runs]() { ++runs; }, now + i % 2);
+    }
+    CHECK(test::WaitFor([&]() {
+	scheduler.ProcessEvents();
+	return runs == kTasks;
+    }));
+    scheduler.Shutdown();
+
+    Scheduler precise(4, 1);
+    CHECK(precise.SetWakeMode(WakeMode::Precise));
+    precise.ProcessEvents();
+}
+
+// Additional MultiQueue dispatchers sleep until tasks expire instead of polling the heaps.
+void TestIdleDispatchers() {
+    Scheduler scheduler(16, 1);
+    CHECK(scheduler.SetWakeMode(WakeMode::Precise));
+    scheduler.SetDispatchers(4);
+    scheduler.SetTimerBackend(TimerBackend::MultiQueue);
+    scheduler.Run();
+
+    auto cpu = bench::CpuTime();
+    auto wall = steady_clock::now();
+    Probe task;
+    auto deadline = std::time(nullptr) + 2;
+    scheduler.Add([&task, deadline]() { task.Record(deadline); }, deadline);
+
+    CHECK(test::WaitFor([&]() { return task.ran.load(); }));
+    CHECK(task.lateness < kMaxLateness);
+    auto elapsed = duration_cast<seconds>(steady_clock::now() - wall) + seconds(1);
+    CHECK(bench::CpuTime() - cpu < kMaxIdleCpu * elapsed.count());
+    scheduler.Shutdown();
+}
+
+// Idle pool workers sleep instead of polling the task ring, and a task added meanwhile still runs at once.
+void TestIdlePool() {
+    internal::ThreadPool pool(4, 64);
+    pool.Run();
+    std::this_thread::sleep_for(milliseconds(100));
+
+    auto cpu = bench::CpuTime();
+    std::this_thread::sleep_for(seconds(1));
+    CHECK(bench::CpuTime() - cpu < kMaxIdleCpu);
+
+    std::atomic<bool> ran = false;
+    auto added = steady_clock::now();
+    pool.AddTask([&ran]() { ran = true; });
+    CHECK(test::WaitFor([&]() { return ran.load(); }));
+    CHECK(steady_clock::now() - added < kMaxLateness);
+    pool.Shutdown();
+}
+
+} // namespace
+
+int main() {
+    TestIdlePool();
+    TestWakesForLaterAdditions(WakeMode::Precise);
+    TestWakesForLaterAdditions(WakeMode::TimerFd);
+    TestWakesForLaterAdditions(WakeMode::External);
+    TestExternalFullRing();
+    TestIdleDispatchers();
+    return 0;
+}